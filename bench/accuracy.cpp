@@ -0,0 +1,216 @@
+/*
+ * accuracy - compare the precision and topology of biquad cascades
+ *
+ * Runs white noise through a range of typical filters with each
+ * biquad_precision and reports, for every filter:
+ *
+ *   - SNR, the power of a reference output computed in long double Direct
+ *     Form I over the power of the difference from it, in dB
+ *   - ns, the best time taken per sample per channel for eight channels
+ *   - which precision automatic chose
+ *
+ * Exits with non-zero status if double_df1 falls below 130dB SNR or if
+ * automatic falls below 110dB SNR for any filter.
+ */
+
+#include "biquad.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+using cascade = biquad_cascade<8>;
+using coefficients = std::array<biquad_coefficients, 8>;
+
+constexpr auto min_double_snr = 130.0;
+constexpr auto min_automatic_snr = 110.0;
+constexpr auto rate = 48000.0;
+constexpr size_t channels = 8;
+constexpr size_t samples = 1 << 16;
+constexpr size_t period = 256;
+constexpr auto Q = 1 / std::numbers::sqrt2;
+
+struct filter {
+	const char *name;
+	std::function<size_t(coefficients &)> design;
+};
+
+const filter filters[] = {
+	{"lowpass 20Hz", [](auto &c) {
+		c[0].lpf(20, Q, rate); return 1; }},
+	{"lowpass 200Hz", [](auto &c) {
+		c[0].lpf(200, Q, rate); return 1; }},
+	{"lowpass 1kHz", [](auto &c) {
+		c[0].lpf(1000, Q, rate); return 1; }},
+	{"lowpass 2kHz", [](auto &c) {
+		c[0].lpf(2000, Q, rate); return 1; }},
+	{"lowpass 20kHz", [](auto &c) {
+		c[0].lpf(20000, Q, rate); return 1; }},
+	{"highpass 20Hz", [](auto &c) {
+		c[0].hpf(20, Q, rate); return 1; }},
+	{"highpass 2kHz", [](auto &c) {
+		c[0].hpf(2000, Q, rate); return 1; }},
+	{"low shelf 50Hz +6dB", [](auto &c) {
+		c[0].low_shelf(50, 6, Q, rate); return 1; }},
+	{"high shelf 8kHz +6dB", [](auto &c) {
+		c[0].high_shelf(8000, 6, Q, rate); return 1; }},
+	{"peaking 100Hz +6dB Q4", [](auto &c) {
+		c[0].peaking_eq(100, 6, 4, rate); return 1; }},
+	{"peaking 3kHz -6dB Q1", [](auto &c) {
+		c[0].peaking_eq(3000, -6, 1, rate); return 1; }},
+	{"butterworth 16 lowpass 5kHz", [](auto &c) {
+		return butterworth_lowpass(data(c), 16, 5000, rate); }},
+	{"linkwitz riley 8 lowpass 80Hz", [](auto &c) {
+		return linkwitz_riley_lowpass(data(c), 8, 80, rate); }},
+	{"linkwitz riley 8 highpass 2kHz", [](auto &c) {
+		return linkwitz_riley_highpass(data(c), 8, 2000, rate); }},
+	/* the same sections in either order */
+	{"peaking 100Hz then highpass 2kHz", [](auto &c) {
+		c[0].peaking_eq(100, 6, 1, rate);
+		c[1].hpf(2000, Q, rate); return 2; }},
+	{"highpass 2kHz then peaking 100Hz", [](auto &c) {
+		c[0].hpf(2000, Q, rate);
+		c[1].peaking_eq(100, 6, 1, rate); return 2; }},
+};
+
+const struct {
+	const char *name;
+	biquad_precision precision;
+} precisions[] = {
+	{"double_df1", biquad_precision::double_df1},
+	{"float_tdf2", biquad_precision::float_tdf2},
+	{"automatic", biquad_precision::automatic},
+};
+
+double
+nanoseconds(clock::duration d)
+{
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+std::vector<float>
+noise(size_t n, unsigned seed)
+{
+	std::mt19937 gen{seed};
+	std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+	std::vector<float> v(n);
+	for (auto &s : v)
+		s = dist(gen);
+	return v;
+}
+
+/*
+ * reference - run the sections in long double Direct Form I
+ */
+std::vector<long double>
+reference(const coefficients &c, size_t sections, const std::vector<float> &x)
+{
+	std::vector<long double> y(begin(x), end(x));
+	for (size_t k = 0; k < sections; ++k) {
+		const auto [b0, b1, b2, a1, a2] = c[k].coefficients();
+		long double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+		for (auto &v : y) {
+			const auto out = b0 * v + b1 * x1 + b2 * x2 - a1 * y1 -
+					 a2 * y2;
+			x2 = x1;
+			x1 = v;
+			y2 = y1;
+			y1 = out;
+			v = out;
+		}
+	}
+	return y;
+}
+
+/*
+ * snr - power of the reference over the power of the error in dB
+ */
+double
+snr(const std::vector<long double> &ref, const std::vector<float> &y)
+{
+	long double signal = 0, error = 0;
+	for (size_t i = 0; i < size(y); ++i) {
+		signal += ref[i] * ref[i];
+		error += (ref[i] - y[i]) * (ref[i] - y[i]);
+	}
+	if (error == 0)
+		return std::numeric_limits<double>::infinity();
+	return 10 * std::log10(static_cast<double>(signal / error));
+}
+
+/*
+ * run - filter every channel a period at a time, returning the time taken
+ * per sample per channel
+ */
+double
+run(cascade &bq, const coefficients &c, size_t sections,
+    const std::vector<std::vector<float>> &x,
+    std::vector<std::vector<float>> &y)
+{
+	const auto start = clock::now();
+	for (size_t i = 0; i < samples; i += period) {
+		std::array<const float *, channels> in;
+		std::array<float *, channels> out;
+		for (size_t ch = 0; ch < channels; ++ch) {
+			in[ch] = &x[ch][i];
+			out[ch] = &y[ch][i];
+		}
+		bq.run(c, sections, data(in), data(out), channels, period);
+	}
+	return nanoseconds(clock::now() - start) / samples / channels;
+}
+
+} /* namespace */
+
+int
+main()
+{
+	std::vector<std::vector<float>> x, y(channels,
+					       std::vector<float>(samples));
+	for (size_t ch = 0; ch < channels; ++ch)
+		x.push_back(noise(samples, ch + 1));
+
+	auto ok = true;
+	printf("%-32s", "filter");
+	for (auto &p : precisions)
+		printf(" %10s %6s", p.name, "ns");
+	printf(" %10s\n", "chose");
+	for (auto &f : filters) {
+		coefficients c;
+		const auto sections = f.design(c);
+		const auto ref = reference(c, sections, x[0]);
+
+		printf("%-32s", f.name);
+		std::array<double, std::size(precisions)> s;
+		std::array<std::vector<float>, std::size(precisions)> out;
+		for (size_t p = 0; p < std::size(precisions); ++p) {
+			auto ns = std::numeric_limits<double>::max();
+			for (int pass = 0; pass < 5; ++pass) {
+				cascade bq;
+				bq.set_precision(precisions[p].precision);
+				ns = std::min(ns, run(bq, c, sections, x, y));
+			}
+			s[p] = snr(ref, y[0]);
+			out[p] = y[0];
+			printf(" %10.1f %6.2f", s[p], ns);
+		}
+		const auto single = out[2] == out[1] && out[2] != out[0];
+		printf(" %10s", single ? "float" : "double");
+
+		const auto pass = s[0] >= min_double_snr &&
+				  s[2] >= min_automatic_snr;
+		printf("%s\n", pass ? "" : "  FAIL");
+		ok &= pass;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/*
+ * compare - compare bench/ladspa results with a baseline
+ *
+ * Reads two files written by ladspa -c, a baseline and the results under
+ * test, each of which may hold several runs, and matches cases by label,
+ * channels, block size, placement, biquad kernel and precision. Reports every
+ * case which is slower or faster than its baseline by more than the
+ * threshold, cases missing from the results, and the geometric mean change in
+ * time over all cases compared.
+ *
+ * Exits with non-zero status if any case is slower than its baseline by more
+ * than the threshold, 10% by default.
+ *
+ * Usage: compare [-t percent] baseline results
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t key_fields = 6;
+constexpr double default_threshold = 10;
+constexpr double min_ns = 0.001;
+
+/*
+ * read - ns of each case in a CSV file from ladspa -c
+ *
+ * Header lines are skipped wherever they are, so the output of several runs
+ * can be concatenated. A case which appears more than once takes its best
+ * time, which filters out runs slowed by other load on the machine.
+ */
+bool
+read(const char *path, std::map<std::string, double> &cases,
+     std::vector<std::string> &order)
+{
+	std::ifstream f{path};
+	if (!f) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	std::string line;
+	for (size_t n = 1; std::getline(f, line); ++n) {
+		if (line.empty() || !line.compare(0, 6, "label,"))
+			continue;
+		std::vector<std::string> fields;
+		std::istringstream s{line};
+		for (std::string field; std::getline(s, field, ',');)
+			fields.push_back(field);
+		char *end = nullptr;
+		auto ns = fields.size() > key_fields
+			? strtod(fields[key_fields].c_str(), &end) : 0;
+		if (!end || end == fields[key_fields].c_str() || *end) {
+			fprintf(stderr, "%s:%zu: bad case\n", path, n);
+			return false;
+		}
+		/* cheap cases can come out at or below 0 after subtracting the
+		 * cost of taking timestamps */
+		ns = std::max(ns, min_ns);
+		std::string key = fields[0];
+		for (size_t i = 1; i < key_fields; ++i)
+			key += " " + fields[i];
+		auto [c, added] = cases.emplace(key, ns);
+		if (added)
+			order.push_back(key);
+		else
+			c->second = std::min(c->second, ns);
+	}
+	return true;
+}
+
+void
+usage()
+{
+	fprintf(stderr, "usage: compare [-t percent] baseline results\n");
+	exit(2);
+}
+
+} /* namespace */
+
+int
+main(int argc, char **argv)
+{
+	auto threshold = default_threshold;
+	if (argc > 1 && !strcmp(argv[1], "-t")) {
+		if (argc < 3)
+			usage();
+		threshold = atof(argv[2]);
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc != 3)
+		usage();
+
+	std::map<std::string, double> baseline, results;
+	std::vector<std::string> order, unused;
+	if (!read(argv[1], baseline, order) ||
+	    !read(argv[2], results, unused))
+		return 2;
+
+	printf("%-70s %10s %10s %8s\n",
+	       "label channels block place kernel precision", "baseline",
+	       "ns", "change");
+	const auto limit = 1 + threshold / 100;
+	size_t compared = 0, slower = 0, faster = 0, missing = 0;
+	double log_sum = 0;
+	for (auto &key : order) {
+		const auto r = results.find(key);
+		if (r == end(results)) {
+			printf("%-70s missing\n", key.c_str());
+			++missing;
+			continue;
+		}
+		const auto base = baseline[key];
+		const auto ratio = r->second / base;
+		++compared;
+		log_sum += std::log(ratio);
+		if (ratio <= limit && ratio >= 1 / limit)
+			continue;
+		const auto is_slower = ratio > limit;
+		slower += is_slower;
+		faster += !is_slower;
+		printf("%-70s %10.3f %10.3f %+7.1f%%%s\n", key.c_str(), base,
+		       r->second, (ratio - 1) * 100,
+		       is_slower ? "  SLOWER" : "");
+	}
+
+	printf("%zu cases compared, %zu slower and %zu faster by more than "
+	       "%g%%, %zu missing\n", compared, slower, faster, threshold,
+	       missing);
+	if (compared)
+		printf("geometric mean change %+.1f%%\n",
+		       (std::exp(log_sum / compared) - 1) * 100);
+	return slower ? 1 : 0;
+}
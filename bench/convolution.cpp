@@ -0,0 +1,218 @@
+/*
+ * convolution - time partitioned convolution against impulse response length
+ *
+ * First runs partitioned_convolution over white noise with impulse responses
+ * of 4k to 64k taps at a range of partition sizes, feeding it a partition at
+ * a time as a host with a matching period would, and reports:
+ *
+ *   - ns, the best time taken per sample
+ *   - load, the share of one core needed to run in real time at 48kHz
+ *   - error, the largest difference from direct convolution computed in
+ *     double precision, relative to the peak of the reference output, which
+ *     must be below 1e-5
+ *
+ * Then compares uniform partitions against nonuniform_convolution for 1 to 5
+ * second impulse responses at a 64 sample period. Running as fast as
+ * possible, ns for the nonuniform engine includes any time run() waits for
+ * the worker. It is also run in real time for a second to report the worst
+ * time run() took for a period, as a share of the period, and the number of
+ * deadlines its worker missed.
+ *
+ * Exits with non-zero status if the error threshold is exceeded.
+ */
+
+#include "nonuniform_convolution.h"
+#include "partitioned_convolution.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr auto max_error = 1e-5;
+constexpr auto rate = 48000.0;
+constexpr size_t long_period = 64;
+
+std::vector<float>
+noise(size_t n, unsigned seed)
+{
+	std::mt19937 gen{seed};
+	std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+	std::vector<float> v(n);
+	for (auto &s : v)
+		s = dist(gen);
+	return v;
+}
+
+/*
+ * room - decaying noise, roughly like a room
+ */
+std::vector<float>
+room(size_t taps)
+{
+	auto ir = noise(taps, 2);
+	for (size_t k = 0; k < taps; ++k)
+		ir[k] *= std::exp(-6.0 * k / taps);
+	return ir;
+}
+
+double
+nanoseconds(clock::duration d)
+{
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+/*
+ * error - compare the last 'checked' outputs with direct convolution
+ */
+double
+error(const std::vector<float> &ir, const std::vector<float> &x,
+      const std::vector<float> &y, size_t latency, size_t checked)
+{
+	double err = 0, peak = 0;
+	for (size_t n = size(y) - checked; n < size(y); ++n) {
+		double ref = 0;
+		const auto m = n - latency;
+		for (size_t k = 0; k < ir.size() && k <= m; ++k)
+			ref += double{ir[k]} * x[m - k];
+		err = std::max(err, std::abs(ref - y[n]));
+		peak = std::max(peak, std::abs(ref));
+	}
+	return err / peak;
+}
+
+/*
+ * best - best time per sample of 'runs' passes of f over 'samples' samples
+ */
+template<typename F>
+double
+best(int runs, size_t samples, F f)
+{
+	auto t = std::numeric_limits<double>::max();
+	for (int run = 0; run < runs; ++run) {
+		const auto start = clock::now();
+		f();
+		t = std::min(t, nanoseconds(clock::now() - start) / samples);
+	}
+	return t;
+}
+
+bool
+uniform()
+{
+	constexpr size_t samples = 1 << 16;
+	const auto x = noise(samples, 1);
+	std::vector<float> y(samples);
+
+	auto ok = true;
+	printf("%8s %10s %10s %10s %12s\n", "taps", "partition", "ns", "load %",
+	       "error");
+	for (size_t taps = 4096; taps <= 65536; taps *= 2) {
+		const auto ir = room(taps);
+		for (size_t partition = 64; partition <= 4096; partition *= 4) {
+			partitioned_convolution c{ir.data(), taps, partition};
+			const auto ns = best(5, samples, [&] {
+				c.reset();
+				for (size_t i = 0; i < samples; i += partition)
+					c.run(&x[i], &y[i], partition);
+			});
+			const auto err = error(ir, x, y, c.latency(), 4096);
+			const auto pass = err < max_error;
+			printf("%8zu %10zu %10.1f %10.2f %12.3g%s\n", taps,
+			       partition, ns, ns * rate * 1e-7, err,
+			       pass ? "" : "  FAIL");
+			ok &= pass;
+		}
+	}
+	return ok;
+}
+
+/*
+ * realtime - run at the pace of a 48kHz host, returning the worst time taken
+ * by run() as a share of the period
+ */
+double
+realtime(nonuniform_convolution &c, const std::vector<float> &x,
+	 std::vector<float> &y)
+{
+	const auto period = std::chrono::nanoseconds{
+	    static_cast<long>(long_period / rate * 1e9)};
+	c.reset();
+	double worst = 0;
+	auto next = clock::now();
+	for (size_t i = 0; i < size(x); i += long_period) {
+		std::this_thread::sleep_until(next);
+		next += period;
+		const auto in = &x[i];
+		const auto out = &y[i];
+		const auto start = clock::now();
+		c.run(&in, &out, 1, long_period);
+		worst = std::max(worst, nanoseconds(clock::now() - start));
+	}
+	return worst / nanoseconds(period);
+}
+
+bool
+nonuniform()
+{
+	constexpr size_t samples = 1 << 18;
+	const auto x = noise(samples, 1);
+	std::vector<float> y(samples);
+
+	auto ok = true;
+	printf("\n%8s %8s %10s %10s %10s %10s %10s %7s %12s\n", "taps", "tail",
+	       "uniform ns", "load %", "ns", "load %", "worst %", "misses",
+	       "error");
+	for (int seconds = 1; seconds <= 5; ++seconds) {
+		const size_t taps = seconds * rate;
+		const auto ir = room(taps);
+
+		partitioned_convolution u{ir.data(), taps, long_period};
+		const auto uns = best(1, samples, [&] {
+			u.reset();
+			for (size_t i = 0; i < samples; i += long_period)
+				u.run(&x[i], &y[i], long_period);
+		});
+
+		nonuniform_convolution c{{ir}, long_period};
+		const auto ns = best(3, samples, [&] {
+			c.reset();
+			for (size_t i = 0; i < samples; i += long_period) {
+				const auto in = &x[i];
+				const auto out = &y[i];
+				c.run(&in, &out, 1, long_period);
+			}
+		});
+		const auto err = error(ir, x, y, c.latency(), 512);
+		const auto pass = err < max_error;
+
+		/* a second of real time */
+		std::vector<float> rx(x.begin(), x.begin() + rate), ry(rate);
+		const auto worst = realtime(c, rx, ry);
+
+		printf("%8zu %8zu %10.1f %10.2f %10.1f %10.2f %10.1f %7zu %12.3g%s\n",
+		       taps, c.tail_partition(), uns, uns * rate * 1e-7, ns,
+		       ns * rate * 1e-7, worst * 100, c.misses(), err,
+		       pass ? "" : "  FAIL");
+		ok &= pass;
+	}
+	return ok;
+}
+
+} /* namespace */
+
+int
+main()
+{
+	auto ok = uniform();
+	ok &= nonuniform();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/*
+ * denormal - time recursive filters decaying into silence
+ *
+ * Runs eight channels through a Linkwitz Riley 8th order lowpass at 1kHz
+ * followed by a slowly decaying 100Hz peaking filter, a 64 sample period at
+ * a time, first with white noise and then with an impulse followed by two
+ * seconds of silence. The impulse response decays through the subnormal
+ * range within that time. This is done with:
+ *
+ *   - naive, a plain single precision TDF-II cascade with nothing to stop it
+ *     decaying into subnormals, to show what they cost on this processor
+ *   - biquad_cascade in each precision, on its own and under denormals_off
+ *     as plugins run it
+ *
+ * and reports ns, the time taken per sample per channel, for noise and for
+ * silence along with the worst period of the silence as a multiple of the
+ * mean for noise.
+ *
+ * Exits with non-zero status if biquad_cascade under denormals_off takes more
+ * than 1.5 times as long per sample for silence as for noise.
+ */
+
+#include "biquad.h"
+#include "denormal.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+using coefficients = std::array<biquad_coefficients, 8>;
+
+constexpr auto max_ratio = 1.5;
+constexpr auto rate = 48000.0;
+constexpr size_t channels = 8;
+constexpr size_t period = 64;
+constexpr size_t samples = 2 * rate;
+
+/*
+ * naive - single precision TDF-II cascade without protection
+ */
+class naive {
+public:
+	naive(const coefficients &c, size_t sections)
+	: sections_{sections}
+	{
+		for (size_t k = 0; k < sections; ++k) {
+			const auto [b0, b1, b2, a1, a2] = c[k].coefficients();
+			c_[k] = {float(b0), float(b1), float(b2), float(a1),
+				 float(a2)};
+		}
+	}
+
+	void run(const float *const *input, float *const *output)
+	{
+		for (size_t ch = 0; ch < channels; ++ch) {
+			for (size_t i = 0; i < period; ++i) {
+				auto x = input[ch][i];
+				for (size_t k = 0; k < sections_; ++k) {
+					const auto &c = c_[k];
+					auto &s = s_[ch][k];
+					const auto y = c[0] * x + s[0];
+					s[0] = c[1] * x - c[3] * y + s[1];
+					s[1] = c[2] * x - c[4] * y;
+					x = y;
+				}
+				output[ch][i] = x;
+			}
+		}
+	}
+
+private:
+	size_t sections_;
+	std::array<std::array<float, 5>, 8> c_;
+	std::array<std::array<std::array<float, 2>, 8>, channels> s_ = {};
+};
+
+struct timing {
+	double noise, silence, worst;
+};
+
+double
+nanoseconds(clock::duration d)
+{
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+/*
+ * measure - time 'run' over noise and then over an impulse and silence
+ */
+timing
+measure(const std::function<void(const float *const *, float *const *)> &run,
+	bool guarded)
+{
+	std::mt19937 gen{1};
+	std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+	std::vector<std::vector<float>> x(channels,
+					  std::vector<float>(samples));
+	std::vector<std::vector<float>> y = x;
+	for (auto &v : x)
+		std::generate(begin(v), end(v), [&] { return dist(gen); });
+
+	auto pass = [&](double &worst) {
+		worst = 0;
+		double total = 0;
+		for (size_t i = 0; i < samples; i += period) {
+			std::array<const float *, channels> in;
+			std::array<float *, channels> out;
+			for (size_t ch = 0; ch < channels; ++ch) {
+				in[ch] = &x[ch][i];
+				out[ch] = &y[ch][i];
+			}
+			const auto start = clock::now();
+			if (guarded) {
+				denormals_off guard;
+				run(data(in), data(out));
+			} else
+				run(data(in), data(out));
+			const auto t = nanoseconds(clock::now() - start);
+			worst = std::max(worst, t);
+			total += t;
+		}
+		worst /= period * channels;
+		return total / samples / channels;
+	};
+
+	timing t;
+	double worst;
+	t.noise = pass(worst);
+	for (auto &v : x) {
+		std::fill(begin(v), end(v), 0.0f);
+		v[0] = 1;
+	}
+	t.silence = pass(worst);
+	t.worst = worst / t.noise;
+	return t;
+}
+
+} /* namespace */
+
+int
+main()
+{
+	coefficients c;
+	auto sections = linkwitz_riley_lowpass(data(c), 8, 1000, rate);
+	c[sections++].peaking_eq(100, 6, 4, rate);
+
+	auto ok = true;
+	printf("%-28s %10s %10s %10s\n", "filter", "noise ns", "silence ns",
+	       "worst x");
+	auto report = [&](const char *name, timing t, bool check) {
+		const auto pass = !check || t.silence <= t.noise * max_ratio;
+		printf("%-28s %10.2f %10.2f %10.1f%s\n", name, t.noise,
+		       t.silence, t.worst, pass ? "" : "  FAIL");
+		ok &= pass;
+	};
+
+	for (auto guarded : {false, true}) {
+		naive n{c, sections};
+		report(guarded ? "naive, denormals_off" : "naive",
+		       measure([&](auto in, auto out) { n.run(in, out); },
+			       guarded), false);
+	}
+
+	const struct {
+		const char *name;
+		biquad_precision precision;
+	} precisions[] = {
+		{"double_df1", biquad_precision::double_df1},
+		{"float_tdf2", biquad_precision::float_tdf2},
+	};
+	for (auto &p : precisions) {
+		for (auto guarded : {false, true}) {
+			biquad_cascade<8> bq;
+			bq.set_precision(p.precision);
+			auto run = [&](auto in, auto out) {
+				bq.run(c, sections, in, out, channels, period);
+			};
+			char name[64];
+			snprintf(name, sizeof(name), "%s%s", p.name,
+				 guarded ? ", denormals_off" : "");
+			report(name, measure(run, guarded), guarded);
+		}
+	}
+	return ok ? 0 : 1;
+}
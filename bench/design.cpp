@@ -0,0 +1,152 @@
+/*
+ * design - compare the fast coefficient design against the exact design
+ *
+ * Designs every filter type over a grid of frequencies, gains and Q at common
+ * sample rates with both biquad_design::exact and biquad_design::fast, reports
+ * the time taken per design and the worst error of the fast design:
+ *
+ *   - coefficient error, the largest absolute difference of any normalised
+ *     coefficient, must be below 1e-10
+ *   - response error, the largest difference in magnitude response measured
+ *     at 64 frequencies from 10Hz to Nyquist, must be below 1e-6dB
+ *
+ * Exits with non-zero status if either threshold is exceeded.
+ */
+
+#include "biquad.h"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <numbers>
+#include <vector>
+
+namespace {
+
+constexpr auto max_coefficient_error = 1e-10;
+constexpr auto max_response_error = 1e-6;	/* in dB */
+
+struct params {
+	double f0, gain, Q, fs;
+};
+
+typedef std::function<void(biquad_coefficients &, const params &,
+			   biquad_design)> designer;
+
+struct type {
+	const char *name;
+	designer design;
+	bool gain;
+	bool Q;
+};
+
+/*
+ * magnitude - magnitude response in dB at frequency f
+ */
+double
+magnitude(const biquad_coefficients &c, double f, double fs)
+{
+	const auto [b0, b1, b2, a1, a2] = c.coefficients();
+	const auto z = std::polar(1.0, -2.0 * std::numbers::pi * f / fs);
+	const auto h = (b0 + z * (b1 + z * b2)) / (1.0 + z * (a1 + z * a2));
+	return 20.0 * std::log10(std::abs(h));
+}
+
+std::vector<params>
+grid(const type &t)
+{
+	std::vector<params> g;
+	for (double fs : {44100.0, 48000.0, 96000.0}) {
+		for (int i = 0; i < 128; ++i) {
+			auto f0 = 10.0 * std::pow(fs * 0.49 / 10.0, i / 127.0);
+			for (int gain = -24; gain <= 24; gain += t.gain ? 3 : 100) {
+				for (double Q : {0.3, 0.5, 0.70710678, 1.0, 2.0, 5.0, 10.0}) {
+					g.push_back({f0, double(gain), Q, fs});
+					if (!t.Q)
+						break;
+				}
+			}
+		}
+	}
+	return g;
+}
+
+/*
+ * time - best time taken per design in nanoseconds
+ */
+double
+time(const type &t, const std::vector<params> &g, biquad_design d)
+{
+	biquad_coefficients c;
+	const auto reps = std::max<size_t>(1, 20000 / g.size());
+	auto best = std::numeric_limits<double>::max();
+	for (int run = 0; run < 10; ++run) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < reps; ++r)
+			for (const auto &p : g)
+				t.design(c, p, d);
+		const auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(
+			end - start).count() / (reps * g.size()));
+	}
+	volatile auto sink = c.coefficients()[0];
+	(void)sink;
+	return best;
+}
+
+} /* namespace */
+
+int
+main()
+{
+	const std::vector<type> types = {
+		{"peaking_eq", [](auto &c, auto &p, auto d) {
+			c.peaking_eq(p.f0, p.gain, p.Q, p.fs, d); }, true, true},
+		{"lpf1", [](auto &c, auto &p, auto d) {
+			c.lpf1(p.f0, p.fs, d); }, false, false},
+		{"lpf", [](auto &c, auto &p, auto d) {
+			c.lpf(p.f0, p.Q, p.fs, d); }, false, true},
+		{"hpf1", [](auto &c, auto &p, auto d) {
+			c.hpf1(p.f0, p.fs, d); }, false, false},
+		{"hpf", [](auto &c, auto &p, auto d) {
+			c.hpf(p.f0, p.Q, p.fs, d); }, false, true},
+		{"low_shelf", [](auto &c, auto &p, auto d) {
+			c.low_shelf(p.f0, p.gain, p.Q, p.fs, d); }, true, true},
+		{"high_shelf", [](auto &c, auto &p, auto d) {
+			c.high_shelf(p.f0, p.gain, p.Q, p.fs, d); }, true, true},
+	};
+
+	auto ok = true;
+	printf("%-12s %12s %12s %16s %16s\n", "type", "exact ns", "fast ns",
+	       "coeff error", "response dB");
+	for (const auto &t : types) {
+		const auto g = grid(t);
+		double coeff_err = 0, resp_err = 0;
+		for (const auto &p : g) {
+			biquad_coefficients e, f;
+			t.design(e, p, biquad_design::exact);
+			t.design(f, p, biquad_design::fast);
+			const auto ce = e.coefficients();
+			const auto cf = f.coefficients();
+			for (size_t k = 0; k < ce.size(); ++k)
+				coeff_err = std::max(coeff_err, std::abs(ce[k] - cf[k]));
+			for (int i = 0; i < 64; ++i) {
+				auto fr = 10.0 * std::pow(p.fs / 2.0 / 10.0, i / 63.0);
+				resp_err = std::max(resp_err,
+					std::abs(magnitude(e, fr, p.fs) -
+						 magnitude(f, fr, p.fs)));
+			}
+		}
+		const auto te = time(t, g, biquad_design::exact);
+		const auto tf = time(t, g, biquad_design::fast);
+		const auto pass = coeff_err < max_coefficient_error &&
+				  resp_err < max_response_error;
+		printf("%-12s %12.1f %12.1f %16.3g %16.3g%s\n", t.name, te, tf,
+		       coeff_err, resp_err, pass ? "" : "  FAIL");
+		ok &= pass;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,409 @@
+/*
+ * ladspa - time every plugin in po-plugins.so as a host would run it
+ *
+ * Loads the plugin library with dlopen, enumerates its descriptors through
+ * ladspa_descriptor() and times run() for every label, which covers each
+ * plugin at 1 to 8 channels, at block sizes of 16 to 8192 samples with
+ * outputs in their own buffers and in place, sharing the buffer of the input
+ * before them. Input is white noise at -6dBFS, refreshed before every run so
+ * that processing in place doesn't wear it down to silence.
+ *
+ * Control inputs take their defaults except where that would bypass
+ * processing: gains are -6dB, eq bands are peaking, highpass filters are 4th
+ * order and delays are 10ms. Set PO_CONVOLVER_IR to time the convolver with
+ * an impulse response, and PO_BIQUAD_KERNEL and PO_BIQUAD_PRECISION to time
+ * other biquad kernels.
+ *
+ * Each case reports the best of several trials, less the time taken to take
+ * timestamps around each run, as:
+ *
+ *   - ns, the time taken per sample per channel
+ *   - cycles, the same in timestamp counter cycles, x86 only
+ *
+ * Usage: ladspa [-c] [library [label...]]
+ *
+ * Runs every label in ./po-plugins.so by default, or only those starting
+ * with one of the given labels. With -c results are written as CSV, one case
+ * per line keyed by label, channels, block size, placement and the biquad
+ * kernel and precision selected by the environment, for bench/compare.
+ */
+
+#include "biquad.h"
+
+#include <ladspa.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr unsigned long rate = 48000;
+constexpr size_t min_block = 16;
+constexpr size_t max_block = 8192;
+constexpr size_t trials = 3;
+constexpr auto trial_time = std::chrono::milliseconds(2);
+constexpr size_t min_runs = 4;
+
+/*
+ * cycles - read the timestamp counter, or 0 where there isn't one
+ */
+uint64_t
+cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+constexpr bool have_cycles =
+#if defined(__x86_64__) || defined(__i386__)
+	true;
+#else
+	false;
+#endif
+
+double
+nanoseconds(clock::duration d)
+{
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+/*
+ * default_value - value of a control port as the LADSPA hints suggest
+ */
+LADSPA_Data
+default_value(const LADSPA_PortRangeHint &h, unsigned long fs)
+{
+	const auto d = h.HintDescriptor;
+	auto lo = h.LowerBound, hi = h.UpperBound;
+	if (LADSPA_IS_HINT_SAMPLE_RATE(d)) {
+		lo *= fs;
+		hi *= fs;
+	}
+	auto mix = [&](double t) -> LADSPA_Data {
+		if (LADSPA_IS_HINT_LOGARITHMIC(d) && lo > 0 && hi > 0)
+			return std::exp(std::log(lo) * (1 - t) +
+					std::log(hi) * t);
+		return lo * (1 - t) + hi * t;
+	};
+
+	LADSPA_Data v = 0;
+	if (LADSPA_IS_HINT_DEFAULT_MINIMUM(d))
+		v = lo;
+	else if (LADSPA_IS_HINT_DEFAULT_LOW(d))
+		v = mix(0.25);
+	else if (LADSPA_IS_HINT_DEFAULT_MIDDLE(d))
+		v = mix(0.5);
+	else if (LADSPA_IS_HINT_DEFAULT_HIGH(d))
+		v = mix(0.75);
+	else if (LADSPA_IS_HINT_DEFAULT_MAXIMUM(d))
+		v = hi;
+	else if (LADSPA_IS_HINT_DEFAULT_1(d))
+		v = 1;
+	else if (LADSPA_IS_HINT_DEFAULT_100(d))
+		v = 100;
+	else if (LADSPA_IS_HINT_DEFAULT_440(d))
+		v = 440;
+	if (LADSPA_IS_HINT_INTEGER(d))
+		v = std::round(v);
+	return v;
+}
+
+/*
+ * workload - value of a control port for timing
+ *
+ * Defaults turn eq bands and highpass filters off and leave gains at 0dB,
+ * which plugins skip, so those are set to something which has to be run.
+ */
+LADSPA_Data
+workload(const std::string &name, const LADSPA_PortRangeHint &h)
+{
+	auto ends = [&](const char *s) {
+		const auto n = strlen(s);
+		return name.size() >= n &&
+		       !name.compare(name.size() - n, n, s);
+	};
+	if (ends(" Type"))
+		return 1;
+	if (ends("Gain (dB)"))
+		return -6;
+	if (name.find("Highpass Order") != std::string::npos)
+		return 4;
+	if (ends("Delay (ms)"))
+		return 10;
+	return default_value(h, rate);
+}
+
+struct result {
+	double ns, cycles;
+};
+
+/*
+ * overhead - time taken to take the timestamps around a run
+ */
+result
+overhead()
+{
+	result r{std::numeric_limits<double>::max(),
+		 std::numeric_limits<double>::max()};
+	for (size_t i = 0; i < 10000; ++i) {
+		const auto t0 = clock::now();
+		const auto c0 = cycles();
+		const auto c1 = cycles();
+		const auto t1 = clock::now();
+		r.ns = std::min(r.ns, nanoseconds(t1 - t0));
+		r.cycles = std::min(r.cycles, double(c1 - c0));
+	}
+	return r;
+}
+
+/*
+ * instance - a plugin instance with buffers for every port
+ */
+class instance {
+public:
+	instance(const LADSPA_Descriptor *d, const std::vector<float> &noise,
+		 result overhead)
+	: d_{d}, noise_{noise}, overhead_{overhead},
+	  controls_(d->PortCount),
+	  buffers_(d->PortCount, std::vector<float>(max_block))
+	{
+		h_ = d->instantiate(d, rate);
+		for (unsigned long p = 0; p < d->PortCount; ++p) {
+			const auto pd = d->PortDescriptors[p];
+			if (LADSPA_IS_PORT_AUDIO(pd) &&
+			    LADSPA_IS_PORT_INPUT(pd))
+				++channels_;
+			if (!LADSPA_IS_PORT_CONTROL(pd))
+				continue;
+			if (LADSPA_IS_PORT_INPUT(pd))
+				controls_[p] = workload(d->PortNames[p],
+							d->PortRangeHints[p]);
+			d->connect_port(h_, p, &controls_[p]);
+		}
+	}
+
+	~instance()
+	{
+		d_->cleanup(h_);
+	}
+
+	/*
+	 * measure - time run() for blocks of 'samples' samples
+	 *
+	 * The time taken to take timestamps is subtracted from every run.
+	 */
+	result measure(size_t samples, bool in_place)
+	{
+		connect(in_place);
+		if (d_->activate)
+			d_->activate(h_);
+
+		/* settle caches, branch predictors & lazy allocations */
+		for (size_t i = 0; i < min_runs; ++i)
+			run(samples);
+
+		result best{std::numeric_limits<double>::max(),
+			    std::numeric_limits<double>::max()};
+		for (size_t t = 0; t < trials; ++t) {
+			clock::duration time{};
+			uint64_t c = 0;
+			size_t runs = 0;
+			while (runs < min_runs || time < trial_time) {
+				refresh(samples);
+				const auto t0 = clock::now();
+				const auto c0 = cycles();
+				d_->run(h_, samples);
+				c += cycles() - c0;
+				time += clock::now() - t0;
+				++runs;
+			}
+			const double n = runs * samples * channels_;
+			const auto ns = nanoseconds(time) - runs * overhead_.ns;
+			const auto cs = c - runs * overhead_.cycles;
+			best.ns = std::min(best.ns, ns / n);
+			best.cycles = std::min(best.cycles, cs / n);
+		}
+
+		if (d_->deactivate)
+			d_->deactivate(h_);
+		return best;
+	}
+
+	size_t channels() const
+	{
+		return channels_;
+	}
+
+private:
+	/* connect each output to its own buffer, or the first output after
+	 * each input to the input's buffer */
+	void connect(bool in_place)
+	{
+		inputs_.clear();
+		float *shared = nullptr;
+		for (unsigned long p = 0; p < d_->PortCount; ++p) {
+			const auto pd = d_->PortDescriptors[p];
+			if (!LADSPA_IS_PORT_AUDIO(pd))
+				continue;
+			auto buf = data(buffers_[p]);
+			if (LADSPA_IS_PORT_INPUT(pd)) {
+				inputs_.push_back(buf);
+				shared = in_place ? buf : nullptr;
+			} else if (shared) {
+				buf = shared;
+				shared = nullptr;
+			}
+			d_->connect_port(h_, p, buf);
+		}
+	}
+
+	void refresh(size_t samples)
+	{
+		for (size_t c = 0; c < inputs_.size(); ++c)
+			memcpy(inputs_[c], &noise_[c * max_block],
+			       samples * sizeof(float));
+	}
+
+	void run(size_t samples)
+	{
+		refresh(samples);
+		d_->run(h_, samples);
+	}
+
+	const LADSPA_Descriptor *d_;
+	LADSPA_Handle h_;
+	const std::vector<float> &noise_;
+	const result overhead_;
+	size_t channels_ = 0;
+	std::vector<LADSPA_Data> controls_;
+	std::vector<std::vector<float>> buffers_;
+	std::vector<float *> inputs_;
+};
+
+/*
+ * kernel_name, precision_name - biquad variant selected by the environment,
+ * as the plugins will read it
+ */
+const char *
+kernel_name()
+{
+	switch (biquad_kernel_from_env()) {
+	case biquad_kernel::channel_parallel:
+		return "channel";
+	case biquad_kernel::time_parallel:
+		return "time";
+	default:
+		return "auto";
+	}
+}
+
+const char *
+precision_name()
+{
+	switch (biquad_precision_from_env()) {
+	case biquad_precision::float_tdf2:
+		return "float";
+	case biquad_precision::automatic:
+		return "auto";
+	default:
+		return "double";
+	}
+}
+
+bool
+selected(const char *label, int argc, char **argv)
+{
+	if (argc <= 2)
+		return true;
+	for (int i = 2; i < argc; ++i)
+		if (!strncmp(label, argv[i], strlen(argv[i])))
+			return true;
+	return false;
+}
+
+} /* namespace */
+
+int
+main(int argc, char **argv)
+{
+	const bool csv = argc > 1 && !strcmp(argv[1], "-c");
+	if (csv) {
+		--argc;
+		++argv;
+	}
+	const auto path = argc > 1 ? argv[1] : "./po-plugins.so";
+	auto lib = dlopen(path, RTLD_NOW);
+	if (!lib) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	auto descriptor = reinterpret_cast<LADSPA_Descriptor_Function>(
+	    dlsym(lib, "ladspa_descriptor"));
+	if (!descriptor) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+
+	/* -6dBFS white noise, a block for each channel */
+	std::mt19937 gen{1};
+	std::uniform_real_distribution<float> dist{-0.5f, 0.5f};
+	std::vector<float> noise(8 * max_block);
+	std::generate(begin(noise), end(noise), [&] { return dist(gen); });
+
+	const auto timestamps = overhead();
+	const auto kernel = kernel_name(), precision = precision_name();
+	if (csv)
+		printf("label,channels,block,place,kernel,precision,"
+		       "ns,cycles\n");
+	else
+		printf("%-36s %3s %5s %-6s %10s %10s\n", "label", "ch",
+		       "block", "place", "ns", have_cycles ? "cycles" : "");
+	const LADSPA_Descriptor *d;
+	for (unsigned long i = 0; (d = descriptor(i)); ++i) {
+		if (!selected(d->Label, argc, argv))
+			continue;
+		instance inst{d, noise, timestamps};
+		for (auto samples = min_block; samples <= max_block;
+		     samples *= 2) {
+			for (auto in_place : {false, true}) {
+				const auto r = inst.measure(samples, in_place);
+				const auto place = in_place ? "in" : "out";
+				if (csv) {
+					printf("%s,%zu,%zu,%s,%s,%s,%.3f,",
+					       d->Label, inst.channels(),
+					       samples, place, kernel,
+					       precision, r.ns);
+					if (have_cycles)
+						printf("%.2f", r.cycles);
+				} else {
+					printf("%-36s %3zu %5zu %-6s %10.3f",
+					       d->Label, inst.channels(),
+					       samples, place, r.ns);
+					if (have_cycles)
+						printf(" %10.2f", r.cycles);
+				}
+				printf("\n");
+				fflush(stdout);
+			}
+		}
+	}
+	dlclose(lib);
+	return 0;
+}
@@ -1,39 +1,1010 @@
 #include "biquad.h"
 
+#include "simd.h"
+#include "store.h"
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <numbers>
+#include <string_view>
+#include <type_traits>
 
 #define dbg(...)
 
+namespace {
+
+typedef double v4d __attribute__((vector_size(4 * sizeof(double))));
+typedef double v2d __attribute__((vector_size(2 * sizeof(double))));
+typedef double v4d_alias __attribute__((vector_size(4 * sizeof(double)),
+					 may_alias));
+typedef float v8f __attribute__((vector_size(8 * sizeof(float))));
+typedef float v4f __attribute__((vector_size(4 * sizeof(float))));
+typedef float v2f __attribute__((vector_size(2 * sizeof(float))));
+
+constexpr auto stride = biquad_cascade<1>::max_channels;
+
 /*
- * biquad::run - run biquad filter across sample data
+ * section - coefficients of one cascade section unpacked for the kernels
  */
-void
-biquad::run(const biquad_coefficients &c,
-	    const float *input, float *output, size_t samples)
+template<typename T>
+struct basic_section {
+	T b0, b1, b2, a1, a2;
+};
+using section = basic_section<double>;
+using float_section = basic_section<float>;
+
+/*
+ * min_float_margin - smallest distance of the denominator of a section from
+ * zero at DC and Nyquist for automatic precision to choose float
+ *
+ * Poles close to z = 1 or z = -1 amplify the rounding noise of a single
+ * precision recursion, more so the closer they are. 2e-2 keeps float
+ * sections above 110dB SNR, see bench/accuracy.cpp.
+ */
+constexpr auto min_float_margin = 2e-2;
+
+/*
+ * min_state - magnitude below which filter state is flushed to zero
+ *
+ * Far below anything that can reach a float output, but far enough above the
+ * subnormal range of single precision that the state of silent filters
+ * never decays into it.
+ */
+constexpr auto min_state = 1e-30;
+
+/*
+ * lanes - coefficients of one section with a lane for each channel
+ */
+template<typename V>
+struct lanes {
+	V b0, b1, b2, a1, a2;
+};
+
+/*
+ * taylor - Taylor series coefficients of sin(x) / x (first = 1) or cos(x)
+ * (first = 0) as polynomials in x^2
+ */
+template<size_t N>
+constexpr std::array<double, N>
+taylor(int first)
+{
+	std::array<double, N> c{};
+	double f = 1;
+	for (int i = 1; i <= first; ++i)
+		f *= i;
+	for (size_t k = 0; k < N; ++k) {
+		c[k] = (k % 2 ? -1 : 1) / f;
+		f *= (first + 2 * k + 1) * (first + 2 * k + 2);
+	}
+	return c;
+}
+
+/*
+ * polynomial - evaluate c[B] + c[B + 1] x + ... + c[E - 1] x^(E - B - 1)
+ *
+ * Uses Estrin's scheme to keep the dependency chain short.
+ */
+template<size_t B, size_t E, size_t N>
+inline double
+polynomial(const std::array<double, N> &c, double x)
+{
+	if constexpr (E - B == 1)
+		return c[B];
+	else {
+		constexpr auto M = B + (E - B + 1) / 2;
+		auto xm = x;
+		for (size_t k = 1; k < M - B; ++k)
+			xm *= x;
+		return polynomial<B, M>(c, x) + xm * polynomial<M, E>(c, x);
+	}
+}
+
+template<size_t N>
+inline double
+polynomial(const std::array<double, N> &c, double x)
+{
+	return polynomial<0, N>(c, x);
+}
+
+/*
+ * exp_series - Taylor series coefficients of exp(x)
+ */
+template<size_t N>
+constexpr std::array<double, N>
+exp_series()
+{
+	std::array<double, N> c{};
+	double f = 1;
+	for (size_t k = 0; k < N; ++k) {
+		c[k] = 1 / f;
+		f *= k + 1;
+	}
+	return c;
+}
+
+/*
+ * sin_cos - sine and cosine of w0
+ *
+ * The fast design folds w0 into [0, pi / 4] where the truncated series below
+ * are accurate to better than 1e-11 and swaps or negates the results to suit.
+ */
+struct sin_cos {
+	double s, c;
+};
+
+sin_cos
+trig(double w0, biquad_design d)
+{
+	using std::numbers::pi;
+	if (d == biquad_design::exact || w0 < 0 || w0 > pi)
+		return {std::sin(w0), std::cos(w0)};
+
+	static constexpr auto sin_c = taylor<7>(1);
+	static constexpr auto cos_c = taylor<8>(0);
+	const auto reflect = w0 > pi / 2;
+	auto x = reflect ? pi - w0 : w0;
+	const auto swap = x > pi / 4;
+	x = swap ? pi / 2 - x : x;
+	const auto x2 = x * x;
+	const auto s = x * polynomial(sin_c, x2);
+	const auto c = polynomial(cos_c, x2);
+	return {swap ? c : s, (swap ? s : c) * (reflect ? -1 : 1)};
+}
+
+/*
+ * tangent - tan(w), w must be in [0, pi / 2)
+ */
+double
+tangent(double w, biquad_design d)
+{
+	if (d == biquad_design::exact)
+		return std::tan(w);
+	const auto [s, c] = trig(w, d);
+	return s / c;
+}
+
+/*
+ * amplitude - convert gain in dB to the cookbook amplitude 10^(gain/40)
+ *
+ * The fast design works in powers of two. The exponent is rounded to a
+ * multiple of 1/32, whose integer part is written straight into the exponent
+ * bits and whose fraction is looked up in a table, leaving a remainder within
+ * +-1/64 for which the series for exp is accurate to better than 1e-14.
+ */
+double
+amplitude(double gain, biquad_design d)
 {
-	/*
-	 * Eq 4:    y[n] = (b0/a0)*x[n] + (b1/a0)*x[n-1] + (b2/a0)*x[n-2]
-	 *			        - (a1/a0)*y[n-1] - (a2/a0)*y[n-2]
-	 *
-	 * We normalise the coefficients so don't need to divide by a0.
-	 *
-	 * Careful, input and output arrays can point to the same place!
-	 */
+	if (d == biquad_design::exact)
+		return std::pow(10.0, gain / 40.0);
+
+	static constexpr auto exp_c = exp_series<6>();
+	static constexpr auto exp2_table = [] {
+		constexpr auto series = exp_series<24>();
+		std::array<double, 32> t{};
+		for (size_t k = 0; k < t.size(); ++k) {
+			const auto x = k / 32.0 * std::numbers::ln2;
+			double r = 0;
+			for (size_t j = series.size(); j > 0; --j)
+				r = r * x + series[j - 1];
+			t[k] = r;
+		}
+		return t;
+	}();
+	const auto t = std::clamp(gain / 40.0 * std::numbers::log2e /
+				  std::numbers::log10e, -1000.0, 1000.0) * 32;
+	/* round by truncation, std::nearbyint is a library call without
+	 * SSE4.1 */
+	const auto n = static_cast<int64_t>(t < 0 ? t - 0.5 : t + 0.5);
+	const auto e = std::bit_cast<double>(static_cast<uint64_t>(
+		(n >> 5) + 1023) << 52);
+	return e * exp2_table[n & 31] *
+	       polynomial(exp_c, (t - n) / 32 * std::numbers::ln2);
+}
+
+/*
+ * run_lanes - run M cascaded biquad filters across W channels in lockstep
+ *
+ * V is a vector of W doubles, one lane per channel, and F the matching vector
+ * of floats. Both are plain scalars for a single channel. C is section when
+ * all channels share coefficients or lanes<V> when each has its own. State
+ * is loaded into registers on entry and written back on exit. Results are
+ * written out by the store policy S.
+ */
+template<typename V, typename F, size_t W, size_t M, typename S,
+	 typename C = section>
+__attribute__((always_inline)) inline void
+run_lanes(const C *c, double *z1p, double *z2p,
+	  const float *const *input, float *const *output, size_t samples,
+	  S store)
+{
+	V z1[M + 1], z2[M + 1];
+	for (size_t k = 0; k <= M; ++k) {
+		memcpy(&z1[k], z1p + k * stride, sizeof(V));
+		memcpy(&z2[k], z2p + k * stride, sizeof(V));
+	}
+
+	/* careful, input and output arrays can point to the same place */
 	for (size_t i = 0; i < samples; ++i) {
-		auto x0 = input[i];
-		auto y0 = c.b0 * x0 + c.b1 * x1 + c.b2 * x2 -
-				      c.a1 * y1 - c.a2 * y2;
-		x2 = x1;
-		x1 = x0;
-		y2 = y1;
-		y1 = y0;
-		output[i] = y0;
+		V x;
+		if constexpr (W == 1)
+			x = input[0][i];
+		else {
+			F f;
+			for (size_t k = 0; k < W; ++k)
+				f[k] = input[k][i];
+			x = __builtin_convertvector(f, V);
+		}
+		for (size_t k = 0; k < M; ++k) {
+			/* feedback terms last to shorten the dependency chain */
+			V y = c[k].b0 * x + c[k].b1 * z1[k] + c[k].b2 * z2[k] -
+			      c[k].a2 * z2[k + 1] - c[k].a1 * z1[k + 1];
+			z2[k] = z1[k];
+			z1[k] = x;
+			x = y;
+		}
+		z2[M] = z1[M];
+		z1[M] = x;
+		if constexpr (W == 1)
+			store(output[0][i], static_cast<float>(x));
+		else {
+			auto f = __builtin_convertvector(x, F);
+			for (size_t k = 0; k < W; ++k)
+				store(output[k][i], f[k]);
+		}
+	}
+
+	for (size_t k = 0; k <= M; ++k) {
+		memcpy(z1p + k * stride, &z1[k], sizeof(V));
+		memcpy(z2p + k * stride, &z2[k], sizeof(V));
+	}
+}
+
+template<size_t M, typename S, typename C = section>
+simd_clones void
+run_4(const C *c, double *z1, double *z2,
+      const float *const *input, float *const *output, size_t samples,
+      S store)
+{
+	run_lanes<v4d, v4f, 4, M>(c, z1, z2, input, output, samples, store);
+}
+
+template<size_t M, typename S, typename C = section>
+simd_clones void
+run_2(const C *c, double *z1, double *z2,
+      const float *const *input, float *const *output, size_t samples,
+      S store)
+{
+	run_lanes<v2d, v2f, 2, M>(c, z1, z2, input, output, samples, store);
+}
+
+/*
+ * run_time - run M cascaded biquad filters across C channels
+ *
+ * Computes four output samples per step from the block form of each section,
+ * see biquad_coefficients::block_form. The channels are independent, so
+ * interleaving them hides some of the latency of the recursion. Any remaining
+ * samples are filtered one at a time.
+ */
+template<size_t M, size_t C, typename S>
+simd_clones void
+run_time(const section *c, const double *const *blk, double *z1p, double *z2p,
+	 const float *const *input, float *const *output, size_t samples,
+	 S store)
+{
+	double z1[C][M + 1], z2[C][M + 1];
+	for (size_t ch = 0; ch < C; ++ch) {
+		for (size_t k = 0; k <= M; ++k) {
+			z1[ch][k] = z1p[k * stride + ch];
+			z2[ch][k] = z2p[k * stride + ch];
+		}
+	}
+
+	/* careful, input and output arrays can point to the same place */
+	size_t i = 0;
+	for (; i + 4 <= samples; i += 4) {
+		v4d x[C];
+		for (size_t ch = 0; ch < C; ++ch) {
+			v4f f;
+			memcpy(&f, input[ch] + i, sizeof(f));
+			x[ch] = __builtin_convertvector(f, v4d);
+		}
+		for (size_t k = 0; k < M; ++k) {
+			auto b = reinterpret_cast<const v4d_alias *>(blk[k]);
+			for (size_t ch = 0; ch < C; ++ch) {
+				auto &h1 = z1[ch];
+				auto &h2 = z2[ch];
+				auto &v = x[ch];
+				/* summed pairwise so that the additions don't
+				 * form one long dependency chain */
+				v4d y = ((b[2] * v[0] + b[3] * v[1]) +
+					 (b[4] * v[2] + b[5] * v[3])) +
+					((b[0] * h2[k] + b[1] * h1[k]) +
+					 (b[6] * h2[k + 1] + b[7] * h1[k + 1]));
+				h2[k] = v[2];
+				h1[k] = v[3];
+				v = y;
+			}
+		}
+		for (size_t ch = 0; ch < C; ++ch) {
+			z2[ch][M] = x[ch][2];
+			z1[ch][M] = x[ch][3];
+			v4f f;
+			memcpy(&f, output[ch] + i, sizeof(f));
+			store(f, __builtin_convertvector(x[ch], v4f));
+			memcpy(output[ch] + i, &f, sizeof(f));
+		}
+	}
+	for (; i < samples; ++i) {
+		for (size_t ch = 0; ch < C; ++ch) {
+			auto &h1 = z1[ch];
+			auto &h2 = z2[ch];
+			double x = input[ch][i];
+			for (size_t k = 0; k < M; ++k) {
+				double y = c[k].b0 * x + c[k].b1 * h1[k] +
+					   c[k].b2 * h2[k] -
+					   c[k].a2 * h2[k + 1] -
+					   c[k].a1 * h1[k + 1];
+				h2[k] = h1[k];
+				h1[k] = x;
+				x = y;
+			}
+			h2[M] = h1[M];
+			h1[M] = x;
+			store(output[ch][i], static_cast<float>(x));
+		}
+	}
+
+	for (size_t ch = 0; ch < C; ++ch) {
+		for (size_t k = 0; k <= M; ++k) {
+			z1p[k * stride + ch] = z1[ch][k];
+			z2p[k * stride + ch] = z2[ch][k];
+		}
 	}
 }
 
+/*
+ * run_lanes_tdf2 - run M cascaded biquad filters across W channels in single
+ * precision
+ *
+ * As run_lanes, except that V is a vector of W floats and each section is in
+ * Transposed Direct Form II, which needs two state variables per section
+ * rather than the four of Direct Form I and keeps intermediate values close
+ * to the scale of the signal. C is float_section or lanes<V>.
+ *
+ * State is stored in the same form as run_lanes, so kernels can be switched
+ * between runs. It is converted to TDF-II on entry and the input and output
+ * history of each section is recorded over the last two samples for exit.
+ */
+template<typename V, size_t W, size_t M, typename S,
+	 typename C = float_section>
+__attribute__((always_inline)) inline void
+run_lanes_tdf2(const C *c, double *z1p, double *z2p,
+	       const float *const *input, float *const *output,
+	       size_t samples, S store)
+{
+	auto lane = [](auto &v, size_t j) -> auto & {
+		if constexpr (W == 1)
+			return v;
+		else
+			return v[j];
+	};
+
+	V h1[M + 1], h2[M + 1], s1[M], s2[M];
+	for (size_t k = 0; k <= M; ++k) {
+		for (size_t j = 0; j < W; ++j) {
+			lane(h1[k], j) = z1p[k * stride + j];
+			lane(h2[k], j) = z2p[k * stride + j];
+		}
+	}
+	for (size_t k = 0; k < M; ++k) {
+		s1[k] = c[k].b1 * h1[k] + c[k].b2 * h2[k] -
+			c[k].a1 * h1[k + 1] - c[k].a2 * h2[k + 1];
+		s2[k] = c[k].b2 * h1[k] - c[k].a2 * h1[k + 1];
+	}
+
+	auto step = [&](size_t i, auto record) {
+		V x;
+		for (size_t j = 0; j < W; ++j)
+			lane(x, j) = input[j][i];
+		for (size_t k = 0; k < M; ++k) {
+			if constexpr (record) {
+				h2[k] = h1[k];
+				h1[k] = x;
+			}
+			V y = c[k].b0 * x + s1[k];
+			s1[k] = c[k].b1 * x - c[k].a1 * y + s2[k];
+			s2[k] = c[k].b2 * x - c[k].a2 * y;
+			x = y;
+		}
+		if constexpr (record) {
+			h2[M] = h1[M];
+			h1[M] = x;
+		}
+		for (size_t j = 0; j < W; ++j)
+			store(output[j][i], lane(x, j));
+	};
+
+	/* careful, input and output arrays can point to the same place */
+	size_t i = 0;
+	for (; i + 2 < samples; ++i)
+		step(i, std::false_type{});
+	for (; i < samples; ++i)
+		step(i, std::true_type{});
+
+	for (size_t k = 0; k <= M; ++k) {
+		for (size_t j = 0; j < W; ++j) {
+			z1p[k * stride + j] = lane(h1[k], j);
+			z2p[k * stride + j] = lane(h2[k], j);
+		}
+	}
+}
+
+template<size_t M, typename S, typename C = float_section>
+simd_clones void
+run_f8(const C *c, double *z1, double *z2,
+       const float *const *input, float *const *output, size_t samples,
+       S store)
+{
+	run_lanes_tdf2<v8f, 8, M>(c, z1, z2, input, output, samples, store);
+}
+
+template<size_t M, typename S, typename C = float_section>
+simd_clones void
+run_f4(const C *c, double *z1, double *z2,
+       const float *const *input, float *const *output, size_t samples,
+       S store)
+{
+	run_lanes_tdf2<v4f, 4, M>(c, z1, z2, input, output, samples, store);
+}
+
+/*
+ * run_float_sections - run M cascaded single precision sections across all
+ * channels
+ *
+ * Channels are processed eight at a time, with any remainder handled four,
+ * two or one at a time. There is no time parallel form in single precision.
+ */
+template<size_t M, typename S>
+void
+run_float_sections(const float_section *c, double *z1, double *z2,
+		   const float *const *input, float *const *output,
+		   size_t channels, size_t samples, S store)
+{
+	size_t i = 0;
+	for (; i + 8 <= channels; i += 8)
+		run_f8<M>(c, z1 + i, z2 + i, input + i, output + i, samples,
+			  store);
+	for (; i + 4 <= channels; i += 4)
+		run_f4<M>(c, z1 + i, z2 + i, input + i, output + i, samples,
+			  store);
+	for (; i + 2 <= channels; i += 2)
+		run_lanes_tdf2<v2f, 2, M>(c, z1 + i, z2 + i, input + i,
+					  output + i, samples, store);
+	for (; i < channels; ++i)
+		run_lanes_tdf2<float, 1, M>(c, z1 + i, z2 + i, input + i,
+					    output + i, samples, store);
+}
+
+/*
+ * run_float_channel_sections - run M cascaded single precision sections with
+ * coefficients for each channel
+ */
+template<size_t M, typename S>
+void
+run_float_channel_sections(const float_section *const *c, double *z1,
+			   double *z2, const float *const *input,
+			   float *const *output, size_t channels,
+			   size_t samples, S store)
+{
+	auto gather = [&]<typename V>(lanes<V> *l, size_t i) {
+		for (size_t k = 0; k < M; ++k) {
+			for (size_t j = 0; j < sizeof(V) / sizeof(float); ++j) {
+				l[k].b0[j] = c[i + j][k].b0;
+				l[k].b1[j] = c[i + j][k].b1;
+				l[k].b2[j] = c[i + j][k].b2;
+				l[k].a1[j] = c[i + j][k].a1;
+				l[k].a2[j] = c[i + j][k].a2;
+			}
+		}
+	};
+
+	size_t i = 0;
+	for (; i + 8 <= channels; i += 8) {
+		lanes<v8f> l[M];
+		gather(l, i);
+		run_f8<M>(l, z1 + i, z2 + i, input + i, output + i, samples,
+			  store);
+	}
+	for (; i + 4 <= channels; i += 4) {
+		lanes<v4f> l[M];
+		gather(l, i);
+		run_f4<M>(l, z1 + i, z2 + i, input + i, output + i, samples,
+			  store);
+	}
+	for (; i < channels; ++i)
+		run_lanes_tdf2<float, 1, M>(c[i], z1 + i, z2 + i, input + i,
+					    output + i, samples, store);
+}
+
+/*
+ * float_margin - distance of the denominator of a section from zero at DC
+ * and Nyquist
+ */
+double
+float_margin(const section &s)
+{
+	return std::min(std::abs(1 + s.a1 + s.a2), std::abs(1 - s.a1 + s.a2));
+}
+
+/*
+ * single - true if 'count' sections should run in single precision
+ */
+bool
+single(biquad_precision p, const section *s, size_t count)
+{
+	switch (p) {
+	case biquad_precision::double_df1:
+		return false;
+	case biquad_precision::float_tdf2:
+		return true;
+	case biquad_precision::automatic:
+		break;
+	}
+	return std::all_of(s, s + count, [](auto &k) {
+		return float_margin(k) >= min_float_margin;
+	});
+}
+
+/*
+ * run_sections - run M cascaded sections across all channels
+ *
+ * Channel parallel kernels process channels four at a time, with any
+ * remainder handled two or one at a time.
+ */
+template<size_t M, typename S>
+void
+run_sections(biquad_kernel kernel, const section *c, const double *const *blk,
+	     double *z1, double *z2, const float *const *input,
+	     float *const *output, size_t channels, size_t samples, S store)
+{
+	size_t i = 0;
+	if (kernel != biquad_kernel::time_parallel) {
+		for (; i + 4 <= channels; i += 4)
+			run_4<M>(c, z1 + i, z2 + i, input + i, output + i,
+				 samples, store);
+	}
+	if (kernel == biquad_kernel::channel_parallel) {
+		for (; i + 2 <= channels; i += 2)
+			run_2<M>(c, z1 + i, z2 + i, input + i, output + i,
+				 samples, store);
+		for (; i < channels; ++i)
+			run_lanes<double, float, 1, M>(c, z1 + i, z2 + i,
+						       input + i, output + i,
+						       samples, store);
+	}
+	for (; i + 2 <= channels; i += 2)
+		run_time<M, 2>(c, blk, z1 + i, z2 + i, input + i, output + i,
+			       samples, store);
+	for (; i < channels; ++i)
+		run_time<M, 1>(c, blk, z1 + i, z2 + i, input + i, output + i,
+			       samples, store);
+}
+
+/*
+ * run_channel_sections - run M cascaded sections with coefficients for each
+ * channel
+ *
+ * c[i] and blk[i] are the sections of channel i. Channel parallel kernels
+ * process channels four at a time with a lane of coefficients per channel.
+ * The time parallel kernel only runs channels which share coefficients
+ * together, so any remainder is handled one channel at a time.
+ */
+template<size_t M, typename S>
+void
+run_channel_sections(biquad_kernel kernel, const section *const *c,
+		     const double *const *const *blk, double *z1, double *z2,
+		     const float *const *input, float *const *output,
+		     size_t channels, size_t samples, S store)
+{
+	auto gather = [&]<typename V>(lanes<V> *l, size_t i) {
+		for (size_t k = 0; k < M; ++k) {
+			for (size_t j = 0; j < sizeof(V) / sizeof(double); ++j) {
+				l[k].b0[j] = c[i + j][k].b0;
+				l[k].b1[j] = c[i + j][k].b1;
+				l[k].b2[j] = c[i + j][k].b2;
+				l[k].a1[j] = c[i + j][k].a1;
+				l[k].a2[j] = c[i + j][k].a2;
+			}
+		}
+	};
+
+	size_t i = 0;
+	if (kernel != biquad_kernel::time_parallel) {
+		for (; i + 4 <= channels; i += 4) {
+			lanes<v4d> l[M];
+			gather(l, i);
+			run_4<M>(l, z1 + i, z2 + i, input + i, output + i,
+				 samples, store);
+		}
+	}
+	if (kernel == biquad_kernel::channel_parallel) {
+		for (; i + 2 <= channels; i += 2) {
+			lanes<v2d> l[M];
+			gather(l, i);
+			run_2<M>(l, z1 + i, z2 + i, input + i, output + i,
+				 samples, store);
+		}
+		for (; i < channels; ++i)
+			run_lanes<double, float, 1, M>(c[i], z1 + i, z2 + i,
+						       input + i, output + i,
+						       samples, store);
+	}
+	for (; i < channels; ++i)
+		run_time<M, 1>(c[i], blk[i], z1 + i, z2 + i, input + i,
+			       output + i, samples, store);
+}
+
+/*
+ * dispatch_sections - select the kernel depth for a run time section count
+ *
+ * Calls run.template operator()<M>() with M equal to 'sections'.
+ */
+template<size_t M, typename F>
+void
+dispatch_sections(size_t sections, F run)
+{
+	if constexpr (M > 1) {
+		if (sections < M)
+			return dispatch_sections<M - 1>(sections, run);
+	}
+	run.template operator()<M>();
+}
+
+} /* namespace */
+
+/*
+ * biquad_kernel_from_env
+ */
+biquad_kernel
+biquad_kernel_from_env()
+{
+	auto e = getenv("PO_BIQUAD_KERNEL");
+	if (!e)
+		return biquad_kernel::automatic;
+	if (std::string_view{e} == "channel")
+		return biquad_kernel::channel_parallel;
+	if (std::string_view{e} == "time")
+		return biquad_kernel::time_parallel;
+	return biquad_kernel::automatic;
+}
+
+/*
+ * biquad_precision_from_env - precision selected by PO_BIQUAD_PRECISION
+ */
+biquad_precision
+biquad_precision_from_env()
+{
+	auto e = getenv("PO_BIQUAD_PRECISION");
+	if (!e)
+		return biquad_precision::double_df1;
+	if (std::string_view{e} == "float")
+		return biquad_precision::float_tdf2;
+	if (std::string_view{e} == "auto")
+		return biquad_precision::automatic;
+	return biquad_precision::double_df1;
+}
+
+/*
+ * biquad_cascade::run - run the first 'sections' filters across sample data
+ *
+ * 'sections' must be between 1 and N.
+ */
+template<size_t N>
+template<typename S>
+void
+biquad_cascade<N>::run(const std::array<biquad_coefficients, N> &c,
+		       size_t sections, const float *const *input,
+		       float *const *output, size_t channels, size_t samples,
+		       S store)
+{
+	flush();
+
+	std::array<section, N> s;
+	std::array<const double *, N> blk;
+	for (size_t k = 0; k < N; ++k) {
+		s[k] = {c[k].b0, c[k].b1, c[k].b2, c[k].a1, c[k].a2};
+		blk[k] = data(c[k].blk[0]);
+	}
+	if (single(precision_, data(s), sections)) {
+		std::array<float_section, N> f;
+		for (size_t k = 0; k < sections; ++k)
+			f[k] = {float(s[k].b0), float(s[k].b1), float(s[k].b2),
+				float(s[k].a1), float(s[k].a2)};
+		return dispatch_sections<N>(sections, [&]<size_t M>() {
+			run_float_sections<M>(data(f), &z1[0][0], &z2[0][0],
+					      input, output, channels, samples,
+					      store);
+		});
+	}
+	dispatch_sections<N>(sections, [&]<size_t M>() {
+		run_sections<M>(kernel_, data(s), data(blk), &z1[0][0],
+				&z2[0][0], input, output, channels, samples,
+				store);
+	});
+}
+
+/*
+ * biquad_cascade::run - run the first 'sections' filters of each channel
+ *
+ * As above with separate coefficients for each channel.
+ */
+template<size_t N>
+template<typename S>
+void
+biquad_cascade<N>::run(const std::array<biquad_coefficients, N> *const *c,
+		       size_t sections, const float *const *input,
+		       float *const *output, size_t channels, size_t samples,
+		       S store)
+{
+	flush();
+
+	std::array<std::array<section, N>, max_channels> s;
+	std::array<std::array<const double *, N>, max_channels> blk;
+	std::array<const section *, max_channels> sp;
+	std::array<const double *const *, max_channels> bp;
+	auto all_single = true;
+	for (size_t i = 0; i < channels; ++i) {
+		for (size_t k = 0; k < sections; ++k) {
+			auto &ck = (*c[i])[k];
+			s[i][k] = {ck.b0, ck.b1, ck.b2, ck.a1, ck.a2};
+			blk[i][k] = data(ck.blk[0]);
+		}
+		sp[i] = data(s[i]);
+		bp[i] = data(blk[i]);
+		all_single &= single(precision_, sp[i], sections);
+	}
+	if (channels && all_single) {
+		std::array<std::array<float_section, N>, max_channels> f;
+		std::array<const float_section *, max_channels> fp;
+		for (size_t i = 0; i < channels; ++i) {
+			for (size_t k = 0; k < sections; ++k)
+				f[i][k] = {float(s[i][k].b0), float(s[i][k].b1),
+					   float(s[i][k].b2), float(s[i][k].a1),
+					   float(s[i][k].a2)};
+			fp[i] = data(f[i]);
+		}
+		return dispatch_sections<N>(sections, [&]<size_t M>() {
+			run_float_channel_sections<M>(data(fp), &z1[0][0],
+						      &z2[0][0], input, output,
+						      channels, samples, store);
+		});
+	}
+	dispatch_sections<N>(sections, [&]<size_t M>() {
+		run_channel_sections<M>(kernel_, data(sp), data(bp),
+					&z1[0][0], &z2[0][0], input, output,
+					channels, samples, store);
+	});
+}
+
+/*
+ * biquad_cascade::set_kernel - select the vectorisation strategy
+ */
+template<size_t N>
+void
+biquad_cascade<N>::set_kernel(biquad_kernel k)
+{
+	kernel_ = k;
+}
+
+/*
+ * biquad_cascade::flush - zero filter state which has decayed to nothing
+ *
+ * Subnormal arithmetic is very slow, so this keeps the cost of filtering
+ * silence the same as any other signal even where plugins are unable to
+ * flush subnormals to zero in hardware.
+ */
+template<size_t N>
+void
+biquad_cascade<N>::flush()
+{
+	for (auto z : {&z1, &z2})
+		for (auto &h : *z)
+			for (auto &v : h)
+				v = std::abs(v) < min_state ? 0 : v;
+}
+
+/*
+ * biquad_cascade::quiet
+ */
+template<size_t N>
+bool
+biquad_cascade<N>::quiet(size_t sections, double level) const
+{
+	/* no early exit, and an integer mask rather than a bool, so that the
+	 * scan vectorises */
+	int loud = 0;
+	for (auto z : {&z1, &z2})
+		for (size_t k = 0; k <= std::min(sections, N); ++k)
+			for (auto v : (*z)[k])
+				loud |= -(std::abs(v) > level);
+	return !loud;
+}
+
+/*
+ * biquad_cascade::insert
+ *
+ * z[k + 1] is the output history of section k, so the new section's output
+ * history is a copy of its input history and later histories move up.
+ */
+template<size_t N>
+void
+biquad_cascade<N>::insert(size_t k, size_t channel)
+{
+	for (auto z : {&z1, &z2}) {
+		for (size_t r = N; r > k + 1; --r)
+			(*z)[r][channel] = (*z)[r - 1][channel];
+		(*z)[k + 1][channel] = (*z)[k][channel];
+	}
+}
+
+/*
+ * biquad_cascade::erase
+ */
+template<size_t N>
+void
+biquad_cascade<N>::erase(size_t k, size_t channel)
+{
+	for (auto z : {&z1, &z2}) {
+		for (size_t r = k + 1; r < N; ++r)
+			(*z)[r][channel] = (*z)[r + 1][channel];
+		(*z)[N][channel] = 0;
+	}
+}
+
+/*
+ * biquad_cascade::invert
+ */
+template<size_t N>
+void
+biquad_cascade<N>::invert(size_t k, size_t channel)
+{
+	for (auto z : {&z1, &z2})
+		for (size_t r = k; r <= N; ++r)
+			(*z)[r][channel] = -(*z)[r][channel];
+}
+
+/*
+ * biquad_cascade::transparent
+ */
+template<size_t N>
+bool
+biquad_cascade<N>::transparent(size_t k, size_t begin, size_t end,
+			       double level) const
+{
+	int loud = 0;
+	for (auto z : {&z1, &z2}) {
+		const auto &in = (*z)[k], &out = (*z)[k + 1];
+		for (auto c = begin; c < end; ++c)
+			loud |= -(std::abs(out[c] - in[c]) > level);
+	}
+	return !loud;
+}
+
+/*
+ * biquad_cascade::skip
+ */
+template<size_t N>
+void
+biquad_cascade<N>::skip(const float *const *input, size_t channels,
+			size_t samples)
+{
+	for (size_t c = 0; c < channels; ++c) {
+		for (size_t r = 0; r <= N; ++r) {
+			if (samples >= 2) {
+				z2[r][c] = input[c][samples - 2];
+				z1[r][c] = input[c][samples - 1];
+			} else if (samples) {
+				z2[r][c] = z1[r][c];
+				z1[r][c] = input[c][0];
+			}
+		}
+	}
+}
+
+/*
+ * biquad_cascade::set_precision - select the arithmetic
+ *
+ * Takes effect from the next run without disturbing the filter state.
+ */
+template<size_t N>
+void
+biquad_cascade<N>::set_precision(biquad_precision p)
+{
+	precision_ = p;
+}
+
+template class biquad_cascade<1>;
+template class biquad_cascade<2>;
+template class biquad_cascade<4>;
+template class biquad_cascade<8>;
+template class biquad_cascade<16>;
+template void biquad_cascade<1>::run(const std::array<biquad_coefficients, 1> &,
+	size_t, const float *const *, float *const *, size_t, size_t, replace);
+template void biquad_cascade<1>::run(const std::array<biquad_coefficients, 1> &,
+	size_t, const float *const *, float *const *, size_t, size_t, accumulate);
+template void biquad_cascade<2>::run(const std::array<biquad_coefficients, 2> &,
+	size_t, const float *const *, float *const *, size_t, size_t, replace);
+template void biquad_cascade<2>::run(const std::array<biquad_coefficients, 2> &,
+	size_t, const float *const *, float *const *, size_t, size_t, accumulate);
+template void biquad_cascade<4>::run(const std::array<biquad_coefficients, 4> &,
+	size_t, const float *const *, float *const *, size_t, size_t, replace);
+template void biquad_cascade<4>::run(const std::array<biquad_coefficients, 4> &,
+	size_t, const float *const *, float *const *, size_t, size_t, accumulate);
+template void biquad_cascade<8>::run(const std::array<biquad_coefficients, 8> &,
+	size_t, const float *const *, float *const *, size_t, size_t, replace);
+template void biquad_cascade<8>::run(const std::array<biquad_coefficients, 8> &,
+	size_t, const float *const *, float *const *, size_t, size_t, accumulate);
+template void biquad_cascade<16>::run(const std::array<biquad_coefficients, 16> &,
+	size_t, const float *const *, float *const *, size_t, size_t, replace);
+template void biquad_cascade<16>::run(const std::array<biquad_coefficients, 16> &,
+	size_t, const float *const *, float *const *, size_t, size_t, accumulate);
+template void biquad_cascade<16>::run(const std::array<biquad_coefficients, 16> *const *,
+	size_t, const float *const *, float *const *, size_t, size_t, replace);
+template void biquad_cascade<16>::run(const std::array<biquad_coefficients, 16> *const *,
+	size_t, const float *const *, float *const *, size_t, size_t, accumulate);
+
+/*
+ * biquad_coefficients::block_form - compute coefficients of the block form
+ *
+ * The outputs y[0..3] of a block of four samples are a linear function of the
+ * inputs x[0..3] and the filter history x[-2], x[-1], y[-2] & y[-1]. Each
+ * column of that function is found by running the recursion with one of the
+ * terms set to 1 and the rest to 0. Once the inputs are exhausted every
+ * column continues with the homogeneous recursion, so only the first two
+ * outputs of each column need to be worked out directly.
+ */
+void
+biquad_coefficients::block_form()
+{
+	auto column = [&](std::array<double, 4> &c, double y0, double y1) {
+		c[0] = y0;
+		c[1] = y1;
+		c[2] = -a1 * c[1] - a2 * c[0];
+		c[3] = -a1 * c[2] - a2 * c[1];
+	};
+
+	/* x[-2], x[-1] */
+	column(blk[0], b2, -a1 * b2);
+	column(blk[1], b1, b2 - a1 * b1);
+
+	/* x[0] is the impulse response, x[1..3] are delayed copies of it */
+	std::array<double, 4> h;
+	h[0] = b0;
+	h[1] = b1 - a1 * h[0];
+	h[2] = b2 - a1 * h[1] - a2 * h[0];
+	h[3] = -a1 * h[2] - a2 * h[1];
+	for (size_t m = 0; m < 4; ++m)
+		for (size_t j = 0; j < 4; ++j)
+			blk[m + 2][j] = j < m ? 0 : h[j - m];
+
+	/* y[-2], y[-1] */
+	column(blk[6], -a2, a1 * a2);
+	column(blk[7], -a1, a1 * a1 - a2);
+}
+
+/*
+ * biquad_coefficients::coefficients
+ */
+std::array<double, 5>
+biquad_coefficients::coefficients() const
+{
+	return {b0, b1, b2, a1, a2};
+}
+
 /*
  * biquad_coefficients::init_peaking_eq
  *
@@ -41,19 +1012,22 @@ biquad::run(const biquad_coefficients &c,
  */
 void
 biquad_coefficients::peaking_eq(const double f0, double gain, double Q,
-				double fs)
+				double fs, design d)
 {
 	using std::numbers::pi;
 	auto w0 = 2.0 * pi * std::clamp(f0, 1.0, fs * 0.49) / fs;
-	auto A = std::pow(10.0, gain / 40.0);
-	auto alpha = std::sin(w0) / (2.0 * Q);
+	auto [sin_w0, cos_w0] = trig(w0, d);
+	auto A = amplitude(gain, d);
+	auto alpha = sin_w0 / (2.0 * Q);
 	auto a0 = 1.0 + alpha / A;
 	b0 = (1.0 + alpha * A) / a0;
-	b1 = (-2.0 * std::cos(w0)) / a0;
+	b1 = (-2.0 * cos_w0) / a0;
 	b2 = (1.0 - alpha * A) / a0;
-	a1 = (-2.0 * std::cos(w0)) / a0;
+	a1 = (-2.0 * cos_w0) / a0;
 	a2 = (1.0 - alpha / A) / a0;
 
+	block_form();
+
 	dbg("peaking_eq:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
 }
@@ -64,10 +1038,10 @@ biquad_coefficients::peaking_eq(const double f0, double gain, double Q,
  * First order lowpass.
  */
 void
-biquad_coefficients::lpf1(double f0, double fs)
+biquad_coefficients::lpf1(double f0, double fs, design d)
 {
 	using std::numbers::pi;
-	auto x = std::tan(pi * f0 / fs);
+	auto x = tangent(pi * f0 / fs, d);
 	auto a0 = x + 1.0;
 	b0 = x / a0;
 	b1 = b0;
@@ -75,6 +1049,8 @@ biquad_coefficients::lpf1(double f0, double fs)
 	a1 = (x - 1.0) / a0;
 	a2 = 0;
 
+	block_form();
+
 	dbg("lpf1:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
 }
@@ -85,18 +1061,21 @@ biquad_coefficients::lpf1(double f0, double fs)
  * See Audio EQ Cookbook LPF.
  */
 void
-biquad_coefficients::lpf(double f0, double Q, double fs)
+biquad_coefficients::lpf(double f0, double Q, double fs, design d)
 {
 	using std::numbers::pi;
 	auto w0 = 2.0 * pi * std::clamp(f0, 1.0, fs * 0.49) / fs;
-	auto alpha = std::sin(w0) / (2.0 * Q);
+	auto [sin_w0, cos_w0] = trig(w0, d);
+	auto alpha = sin_w0 / (2.0 * Q);
 	auto a0 = 1.0 + alpha;
-	b0 = (1.0 - std::cos(w0)) / 2 / a0;
-	b1 = (1.0 - std::cos(w0)) / a0;
-	b2 = (1.0 - std::cos(w0)) / 2 / a0;
-	a1 = (-2.0 * std::cos(w0)) / a0;
+	b0 = (1.0 - cos_w0) / 2 / a0;
+	b1 = (1.0 - cos_w0) / a0;
+	b2 = (1.0 - cos_w0) / 2 / a0;
+	a1 = (-2.0 * cos_w0) / a0;
 	a2 = (1.0 - alpha) / a0;
 
+	block_form();
+
 	dbg("lpf:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
 }
@@ -107,10 +1086,10 @@ biquad_coefficients::lpf(double f0, double Q, double fs)
  * First order highpass.
  */
 void
-biquad_coefficients::hpf1(double f0, double fs)
+biquad_coefficients::hpf1(double f0, double fs, design d)
 {
 	using std::numbers::pi;
-	auto x = std::tan(pi * f0 / fs);
+	auto x = tangent(pi * f0 / fs, d);
 	auto a0 = x + 1.0;
 	b0 = 1.0 / a0;
 	b1 = -b0;
@@ -118,6 +1097,8 @@ biquad_coefficients::hpf1(double f0, double fs)
 	a1 = (x - 1.0) / a0;
 	a2 = 0;
 
+	block_form();
+
 	dbg("hpf1:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
 }
@@ -128,18 +1109,21 @@ biquad_coefficients::hpf1(double f0, double fs)
  * See Audio EQ Cookbook HPF.
  */
 void
-biquad_coefficients::hpf(double f0, double Q, double fs)
+biquad_coefficients::hpf(double f0, double Q, double fs, design d)
 {
 	using std::numbers::pi;
 	auto w0 = 2.0 * pi * std::clamp(f0, 1.0, fs * 0.49) / fs;
-	auto alpha = std::sin(w0) / (2.0 * Q);
+	auto [sin_w0, cos_w0] = trig(w0, d);
+	auto alpha = sin_w0 / (2.0 * Q);
 	auto a0 = 1.0 + alpha;
-	b0 = (1.0 + std::cos(w0)) / 2 / a0;
-	b1 = -(1.0 + std::cos(w0)) / a0;
-	b2 = (1.0 + std::cos(w0)) / 2 / a0;
-	a1 = (-2.0 * std::cos(w0)) / a0;
+	b0 = (1.0 + cos_w0) / 2 / a0;
+	b1 = -(1.0 + cos_w0) / a0;
+	b2 = (1.0 + cos_w0) / 2 / a0;
+	a1 = (-2.0 * cos_w0) / a0;
 	a2 = (1.0 - alpha) / a0;
 
+	block_form();
+
 	dbg("hpf:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
 }
@@ -150,18 +1134,23 @@ biquad_coefficients::hpf(double f0, double Q, double fs)
  * See Audio EQ Cookbool lowShelf.
  */
 void
-biquad_coefficients::low_shelf(double f0, double gain, double Q, double fs)
+biquad_coefficients::low_shelf(double f0, double gain, double Q, double fs,
+				design d)
 {
 	using std::numbers::pi;
 	auto w0 = 2.0 * pi * std::clamp(f0, 1.0, fs * 0.49) / fs;
-	auto A = std::pow(10.0, gain / 40.0);
-	auto alpha = std::sin(w0) / (2.0 * Q);
-	auto a0 = A + 1.0 + (A - 1.0) * std::cos(w0) + 2.0 * std::sqrt(A) * alpha;
-	b0 = A * (A + 1.0 - (A - 1.0) * std::cos(w0) + 2.0 * std::sqrt(A) * alpha) / a0;
-	b1 = 2.0 * A * (A - 1.0 - (A + 1.0) * std::cos(w0)) / a0;
-	b2 = A * (A + 1.0 - (A - 1.0) * std::cos(w0) - 2.0 * std::sqrt(A) * alpha) / a0;
-	a1 = -2.0 * (A - 1.0 + (A + 1.0) * std::cos(w0)) / a0;
-	a2 = (A + 1.0 + (A - 1.0) * std::cos(w0) - 2.0 * std::sqrt(A) * alpha) / a0;
+	auto [sin_w0, cos_w0] = trig(w0, d);
+	auto A = amplitude(gain, d);
+	auto alpha = sin_w0 / (2.0 * Q);
+	auto beta = 2.0 * std::sqrt(A) * alpha;
+	auto a0 = A + 1.0 + (A - 1.0) * cos_w0 + beta;
+	b0 = A * (A + 1.0 - (A - 1.0) * cos_w0 + beta) / a0;
+	b1 = 2.0 * A * (A - 1.0 - (A + 1.0) * cos_w0) / a0;
+	b2 = A * (A + 1.0 - (A - 1.0) * cos_w0 - beta) / a0;
+	a1 = -2.0 * (A - 1.0 + (A + 1.0) * cos_w0) / a0;
+	a2 = (A + 1.0 + (A - 1.0) * cos_w0 - beta) / a0;
+
+	block_form();
 
 	dbg("low_shelf:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
@@ -173,19 +1162,222 @@ biquad_coefficients::low_shelf(double f0, double gain, double Q, double fs)
  * See Audio EQ Cookbool highShelf.
  */
 void
-biquad_coefficients::high_shelf(double f0, double gain, double Q, double fs)
+biquad_coefficients::high_shelf(double f0, double gain, double Q, double fs,
+				design d)
 {
 	using std::numbers::pi;
 	auto w0 = 2.0 * pi * std::clamp(f0, 1.0, fs * 0.49) / fs;
-	auto A = std::pow(10.0, gain / 40.0);
-	auto alpha = std::sin(w0) / (2.0 * Q);
-	auto a0 = A + 1.0 - (A - 1.0) * std::cos(w0) + 2.0 * std::sqrt(A) * alpha;
-	b0 = A * (A + 1.0 + (A - 1.0) * std::cos(w0) + 2.0 * std::sqrt(A) * alpha) / a0;
-	b1 = -2.0 * A * (A - 1.0 + (A + 1.0) * std::cos(w0)) / a0;
-	b2 = A * (A + 1.0 + (A - 1.0) * std::cos(w0) - 2.0 * std::sqrt(A) * alpha) / a0;
-	a1 = 2.0 * (A - 1.0 - (A + 1.0) * std::cos(w0)) / a0;
-	a2 = (A + 1.0 - (A - 1.0) * std::cos(w0) - 2.0 * std::sqrt(A) * alpha) / a0;
+	auto [sin_w0, cos_w0] = trig(w0, d);
+	auto A = amplitude(gain, d);
+	auto alpha = sin_w0 / (2.0 * Q);
+	auto beta = 2.0 * std::sqrt(A) * alpha;
+	auto a0 = A + 1.0 - (A - 1.0) * cos_w0 + beta;
+	b0 = A * (A + 1.0 + (A - 1.0) * cos_w0 + beta) / a0;
+	b1 = -2.0 * A * (A - 1.0 + (A + 1.0) * cos_w0) / a0;
+	b2 = A * (A + 1.0 + (A - 1.0) * cos_w0 - beta) / a0;
+	a1 = 2.0 * (A - 1.0 - (A + 1.0) * cos_w0) / a0;
+	a2 = (A + 1.0 - (A - 1.0) * cos_w0 - beta) / a0;
+
+	block_form();
 
 	dbg("high_shelf:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
 	    b0, b1, b2, a1, a2);
 }
+
+/*
+ * biquad_coefficients::apf1
+ *
+ * First order allpass, the sum of second order Linkwitz Riley lowpass and
+ * inverted highpass at f0.
+ */
+void
+biquad_coefficients::apf1(double f0, double fs, design d)
+{
+	using std::numbers::pi;
+	auto x = tangent(pi * std::clamp(f0, 1.0, fs * 0.49) / fs, d);
+	b0 = (x - 1.0) / (x + 1.0);
+	b1 = 1.0;
+	b2 = 0;
+	a1 = b0;
+	a2 = 0;
+
+	block_form();
+
+	dbg("apf1:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
+	    b0, b1, b2, a1, a2);
+}
+
+/*
+ * biquad_coefficients::apf
+ *
+ * See Audio EQ Cookbook APF.
+ */
+void
+biquad_coefficients::apf(double f0, double Q, double fs, design d)
+{
+	using std::numbers::pi;
+	auto w0 = 2.0 * pi * std::clamp(f0, 1.0, fs * 0.49) / fs;
+	auto [sin_w0, cos_w0] = trig(w0, d);
+	auto alpha = sin_w0 / (2.0 * Q);
+	auto a0 = 1.0 + alpha;
+	b0 = (1.0 - alpha) / a0;
+	b1 = (-2.0 * cos_w0) / a0;
+	b2 = 1.0;
+	a1 = b1;
+	a2 = b0;
+
+	block_form();
+
+	dbg("apf:\n  b0=%.20f\n  b1=%.20f\n  b2=%.20f\n  a1=%.20f\n  a2=%.20f\n",
+	    b0, b1, b2, a1, a2);
+}
+
+/*
+ * biquad_coefficients::invert
+ */
+void
+biquad_coefficients::invert()
+{
+	b0 = -b0;
+	b1 = -b1;
+	b2 = -b2;
+
+	block_form();
+}
+
+/*
+ * biquad_coefficients::identity
+ *
+ * Passes the input through unchanged.
+ */
+void
+biquad_coefficients::identity()
+{
+	b0 = 1.0;
+	b1 = 0;
+	b2 = 0;
+	a1 = 0;
+	a2 = 0;
+
+	block_form();
+}
+
+/*
+ * biquad_coefficients::passthrough
+ */
+bool
+biquad_coefficients::passthrough() const
+{
+	return b0 == 1 && b1 == a1 && b2 == a2;
+}
+
+namespace {
+
+/*
+ * butterworth_q - Q of the k-th pole pair of a Butterworth filter
+ *
+ * The poles lie on the unit circle at pi * (2k + 1) / (2 * order) from the
+ * negative real axis for even orders, or pi * (k + 1) / order for odd orders,
+ * which also have a real pole.
+ */
+double
+butterworth_q(unsigned order, unsigned k)
+{
+	using std::numbers::pi;
+	return 0.5 / std::cos(pi * (2 * k + 1 + order % 2) / (2.0 * order));
+}
+
+using first_order = void (biquad_coefficients::*)(double, double,
+						  biquad_design);
+using second_order = void (biquad_coefficients::*)(double, double, double,
+						   biquad_design);
+
+/*
+ * butterworth - Butterworth sections of the given types
+ */
+size_t
+butterworth(biquad_coefficients *c, unsigned order, double f0, double fs,
+	    biquad_design d, first_order one, second_order two)
+{
+	size_t n = 0;
+	if (order % 2)
+		(c[n++].*one)(f0, fs, d);
+	for (unsigned k = 0; k < order / 2; ++k)
+		(c[n++].*two)(f0, butterworth_q(order, k), fs, d);
+	return n;
+}
+
+/*
+ * linkwitz_riley - Butterworth sections of half the order, each twice
+ */
+size_t
+linkwitz_riley(biquad_coefficients *c, unsigned order, double f0, double fs,
+	       biquad_design d, second_order two)
+{
+	const auto m = order / 2;
+	size_t n = 0;
+	/* the squared real pole is a second order section of Q 0.5 */
+	if (m % 2)
+		(c[n++].*two)(f0, 0.5, fs, d);
+	for (unsigned k = 0; k < m / 2; ++k) {
+		(c[n++].*two)(f0, butterworth_q(m, k), fs, d);
+		c[n] = c[n - 1];
+		++n;
+	}
+	return n;
+}
+
+} /* namespace */
+
+/*
+ * butterworth_lowpass
+ */
+size_t
+butterworth_lowpass(biquad_coefficients *c, unsigned order, double f0,
+		    double fs, biquad_design d)
+{
+	return butterworth(c, order, f0, fs, d, &biquad_coefficients::lpf1,
+			   &biquad_coefficients::lpf);
+}
+
+/*
+ * butterworth_highpass
+ */
+size_t
+butterworth_highpass(biquad_coefficients *c, unsigned order, double f0,
+		     double fs, biquad_design d)
+{
+	return butterworth(c, order, f0, fs, d, &biquad_coefficients::hpf1,
+			   &biquad_coefficients::hpf);
+}
+
+/*
+ * butterworth_allpass
+ */
+size_t
+butterworth_allpass(biquad_coefficients *c, unsigned order, double f0,
+		    double fs, biquad_design d)
+{
+	return butterworth(c, order, f0, fs, d, &biquad_coefficients::apf1,
+			   &biquad_coefficients::apf);
+}
+
+/*
+ * linkwitz_riley_lowpass
+ */
+size_t
+linkwitz_riley_lowpass(biquad_coefficients *c, unsigned order, double f0,
+		       double fs, biquad_design d)
+{
+	return linkwitz_riley(c, order, f0, fs, d, &biquad_coefficients::lpf);
+}
+
+/*
+ * linkwitz_riley_highpass
+ */
+size_t
+linkwitz_riley_highpass(biquad_coefficients *c, unsigned order, double f0,
+			double fs, biquad_design d)
+{
+	return linkwitz_riley(c, order, f0, fs, d, &biquad_coefficients::hpf);
+}
@@ -1,36 +1,242 @@
 #pragma once
 
+#include "store.h"
+#include <array>
 #include <cstddef>
 
 class biquad_coefficients;
 
 /*
- * biquad - simple biquad filter
+ * biquad_kernel - strategy used to vectorise biquad filters
  *
- * For details on how this works see the Audio EQ Cookbook.
+ * channel_parallel advances several channels through each sample together.
+ * time_parallel computes several samples of a single channel per step using
+ * the block form of the recursion. automatic uses channel_parallel for groups
+ * of four channels and time_parallel for any remaining channels.
  */
-class biquad {
-public:
-	void run(const biquad_coefficients &,
-		 const float *input, float *output, size_t samples);
+enum class biquad_kernel {
+	automatic,
+	channel_parallel,
+	time_parallel,
+};
 
-private:
-	double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+/*
+ * biquad_kernel_from_env - kernel selected by the PO_BIQUAD_KERNEL variable
+ *
+ * Recognises "channel" and "time", anything else selects automatic.
+ */
+biquad_kernel biquad_kernel_from_env();
+
+/*
+ * biquad_precision - arithmetic used to run biquad filters
+ *
+ * double_df1 runs each section in Direct Form I in double precision.
+ * float_tdf2 runs each section in Transposed Direct Form II in single
+ * precision, which fits twice as many channels into each SIMD register but
+ * adds rounding noise to sections with poles close to DC or Nyquist, such as
+ * low frequency shelves. That noise is only attenuated by the sections after
+ * them, so it is worst where an earlier section has already cut the band it
+ * lies in, as when a speaker processor channel highpasses at 2kHz before a
+ * 100Hz band. automatic chooses float_tdf2 for a run only if no section has
+ * poles that close, see bench/accuracy.cpp.
+ */
+enum class biquad_precision {
+	double_df1,
+	float_tdf2,
+	automatic,
+};
+
+/*
+ * biquad_precision_from_env - precision selected by PO_BIQUAD_PRECISION
+ *
+ * Recognises "float" and "auto", anything else selects double_df1.
+ */
+biquad_precision biquad_precision_from_env();
+
+/*
+ * biquad_design - how coefficients are computed
+ *
+ * exact uses the standard library maths functions. fast uses polynomial
+ * approximations which are accurate to better than 1e-10 relative to exact
+ * and are intended for designs recomputed while parameters are ramping, see
+ * bench/design.cpp.
+ */
+enum class biquad_design {
+	exact,
+	fast,
 };
 
 class biquad_coefficients {
 public:
-	void peaking_eq(double f0, double gain, double Q, double fs);
-	void lpf1(double f0, double fs);
-	void lpf(double f0, double Q, double fs);
-	void hpf1(double f0, double fs);
-	void hpf(double f0, double Q, double fs);
-	void low_shelf(double f0, double gain, double Q, double fs);
-	void high_shelf(double f0, double gain, double Q, double fs);
+	using design = biquad_design;
+
+	void peaking_eq(double f0, double gain, double Q, double fs,
+			design = design::exact);
+	void lpf1(double f0, double fs, design = design::exact);
+	void lpf(double f0, double Q, double fs, design = design::exact);
+	void hpf1(double f0, double fs, design = design::exact);
+	void hpf(double f0, double Q, double fs, design = design::exact);
+	void low_shelf(double f0, double gain, double Q, double fs,
+		       design = design::exact);
+	void high_shelf(double f0, double gain, double Q, double fs,
+			design = design::exact);
+	void apf1(double f0, double fs, design = design::exact);
+	void apf(double f0, double Q, double fs, design = design::exact);
+
+	void identity();
+
+	/*
+	 * passthrough - check if the section passes its input through
+	 * unchanged, because its zeros cancel its poles exactly
+	 *
+	 * This is the case for peaking and shelving filters designed exactly
+	 * at 0dB as well as for identity().
+	 */
+	bool passthrough() const;
+
+	/* negate the numerator, inverting the polarity of the output */
+	void invert();
+
+	/* normalised coefficients as { b0, b1, b2, a1, a2 } */
+	std::array<double, 5> coefficients() const;
 
 private:
+	void block_form();
+
 	double b0 = 0, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
 
-	friend class biquad;
+	/* y[0..3] = sum of blk[m][0..3] * {x[-2], x[-1], x[0], x[1], x[2],
+	 * x[3], y[-2], y[-1]}[m], see biquad_coefficients::block_form */
+	alignas(32) std::array<std::array<double, 4>, 8> blk = {};
+
+	template<size_t> friend class biquad_cascade;
 };
 
+/*
+ * butterworth_lowpass, butterworth_highpass - Butterworth filter of any order
+ *
+ * Odd orders start with a first order section, followed by a second order
+ * section for each pair of poles in order of increasing Q. Returns the number
+ * of sections written to 'c', which is (order + 1) / 2.
+ */
+size_t butterworth_lowpass(biquad_coefficients *c, unsigned order, double f0,
+			   double fs, biquad_design = biquad_design::exact);
+size_t butterworth_highpass(biquad_coefficients *c, unsigned order, double f0,
+			    double fs, biquad_design = biquad_design::exact);
+
+/*
+ * linkwitz_riley_lowpass, linkwitz_riley_highpass - Linkwitz Riley filter of
+ * any even order
+ *
+ * Two cascaded Butterworth filters of half the order, with the two first
+ * order sections of odd halves merged into one second order section of Q 0.5.
+ * Returns the number of sections written to 'c', which is order / 2.
+ *
+ * The lowpass and highpass sum to butterworth_allpass of half the order,
+ * with the highpass inverted if half the order is odd.
+ */
+size_t linkwitz_riley_lowpass(biquad_coefficients *c, unsigned order,
+			      double f0, double fs,
+			      biquad_design = biquad_design::exact);
+size_t linkwitz_riley_highpass(biquad_coefficients *c, unsigned order,
+			       double f0, double fs,
+			       biquad_design = biquad_design::exact);
+
+/*
+ * butterworth_allpass - allpass with the phase of a Butterworth filter
+ *
+ * Sections are as butterworth_lowpass. Returns the number of sections
+ * written to 'c', which is (order + 1) / 2.
+ */
+size_t butterworth_allpass(biquad_coefficients *c, unsigned order, double f0,
+			   double fs, biquad_design = biquad_design::exact);
+
+/*
+ * biquad_cascade - cascade of biquad filters for multiple channels
+ *
+ * Each sample is pushed through every section before it is stored, so the
+ * sample data is read and written once regardless of the number of sections.
+ * Filter state is kept in structure-of-arrays form so that groups of channels
+ * can be advanced through each sample together in SIMD registers. This also
+ * works when each channel has its own coefficients.
+ */
+template<size_t N>
+class biquad_cascade {
+public:
+	static constexpr size_t max_channels = 8;
+
+	/* S is replace for run() and accumulate for run_adding() */
+	template<typename S = replace>
+	void run(const std::array<biquad_coefficients, N> &, size_t sections,
+		 const float *const *input, float *const *output,
+		 size_t channels, size_t samples, S = {});
+
+	/* as above with separate coefficients for each channel */
+	template<typename S = replace>
+	void run(const std::array<biquad_coefficients, N> *const *,
+		 size_t sections, const float *const *input,
+		 float *const *output, size_t channels, size_t samples,
+		 S = {});
+	void set_kernel(biquad_kernel);
+	void set_precision(biquad_precision);
+
+	/*
+	 * quiet - check if the input history and the state of the first
+	 * 'sections' sections are all below 'level' in magnitude
+	 *
+	 * The output of a quiet cascade stays near 'level' for as long as
+	 * its input does.
+	 */
+	bool quiet(size_t sections, double level) const;
+
+	/*
+	 * insert, erase - add or remove section k of one channel without
+	 * disturbing the state of the other sections
+	 *
+	 * An inserted section starts out with the history of one which has
+	 * been passing its input through, and erasing a section which passes
+	 * its input through leaves the output unchanged. There must be fewer
+	 * than N sections to insert one.
+	 */
+	void insert(size_t k, size_t channel);
+	void erase(size_t k, size_t channel);
+
+	/*
+	 * invert - flip the polarity of the state of one channel from the
+	 * input of section k on
+	 *
+	 * Keeps the output continuous when the input of section k, or the
+	 * polarity of its coefficients, is inverted.
+	 */
+	void invert(size_t k, size_t channel);
+
+	/*
+	 * transparent - check if section k of channels 'begin' to 'end' has
+	 * been passing its input through, to within 'level' (-160dB)
+	 *
+	 * A section designed to pass its input through still adds the decaying
+	 * response to earlier input for a while. Erasing or skipping it before
+	 * then would be audible as a step.
+	 */
+	bool transparent(size_t k, size_t begin, size_t end,
+			 double level = 1e-8) const;
+
+	/*
+	 * skip - record input which was passed around the cascade
+	 *
+	 * Used instead of run() while every section passes its input through,
+	 * so that they can be run again later without a glitch.
+	 */
+	void skip(const float *const *input, size_t channels, size_t samples);
+
+private:
+	void flush();
+
+	biquad_kernel kernel_ = biquad_kernel::automatic;
+	biquad_precision precision_ = biquad_precision::double_df1;
+
+	/* z[0] holds the input history and z[k + 1] the output history of
+	 * section k, which is also the input history of section k + 1 */
+	alignas(32) std::array<std::array<double, max_channels>, N + 1>
+		z1 = {}, z2 = {};
+};
@@ -0,0 +1,1408 @@
+/*
+ * host - check the response of every plugin against its design
+ *
+ * First checks the biquad_coefficients designs against closed form
+ * responses: Butterworth and Linkwitz Riley magnitudes, unit magnitude
+ * allpasses, and the gains of the cookbook filters at DC, f0 and Nyquist.
+ *
+ * Then instantiates every plugin in po-plugins.so directly, as a LADSPA host
+ * would, at 1, 3 and 8 channels and measures the response of each output two
+ * ways:
+ *
+ *   - impulse, a unit impulse run out of place a block at a time, and
+ *     transformed with an FFT
+ *   - sweep, an exponential sine sweep from 20Hz to 20kHz run in place in
+ *     irregular blocks of 1 to 4096 samples, with the transform of the output
+ *     divided by that of the sweep from 30Hz to 16kHz
+ *
+ * Both run for 8192 samples, or 32768 for the plugins with long impulse
+ * responses, the linear phase crossover and the convolver. The linear phase
+ * crossover is only checked at 1 and 3 channels.
+ *
+ * Each channel's input is scaled differently so that crosstalk between
+ * channels shows up as error. Magnitude, phase and group delay are compared
+ * with the expected response wherever it is within 60dB of its peak. This is
+ * built from the same biquad_coefficients designs the plugins use, from
+ * delays, gains and impulse responses, or, for the linear phase crossover,
+ * from the Linkwitz Riley magnitudes it approximates. Output written by
+ * run_adding is compared with run in the time domain.
+ *
+ * Finally changes the controls of plugins while they run noise, checking
+ * that the output stays bounded, that it settles to that of an instance set
+ * up with the new controls, and that the plugin goes idle once input stops.
+ *
+ * Reports the largest error of each case in magnitude (dB), phase (degrees)
+ * and group delay (samples). Exits with non-zero status if any exceeds its
+ * tolerance. PO_BIQUAD_KERNEL and PO_BIQUAD_PRECISION select the biquad
+ * kernel and precision as they do for the plugins, and with
+ * PO_BIQUAD_PRECISION=float the plugins with biquad filters are held to
+ * looser tolerances of their own.
+ *
+ * Usage: host [library [label...]]
+ *
+ * Checks every label in ./po-plugins.so by default, or only those starting
+ * with one of the given labels.
+ */
+
+#include "biquad.h"
+
+#include <ladspa.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <functional>
+#include <numbers>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using cplx = std::complex<double>;
+using std::numbers::pi;
+
+constexpr unsigned long rate = 48000;
+/* samples run and transformed, long enough for every response to decay */
+constexpr size_t short_length = 1 << 13;
+constexpr size_t long_length = 1 << 15;
+constexpr size_t impulse_block = 1024;
+constexpr size_t sweep_blocks[] = {1, 7, 100, 4096, 333};
+constexpr LADSPA_Data adding_gain = 0.5;
+
+LADSPA_Descriptor_Function descriptors;
+std::vector<std::string> labels;
+bool ok = true;
+
+/*
+ * response - frequency response as a function of angular frequency
+ */
+using response = std::function<cplx(double w)>;
+
+response
+operator*(response a, response b)
+{
+	return [a, b](double w) { return a(w) * b(w); };
+}
+
+/*
+ * cascade - response of 'n' biquad sections
+ */
+response
+cascade(const biquad_coefficients *c, size_t n)
+{
+	std::vector<std::array<double, 5>> s;
+	for (size_t k = 0; k < n; ++k)
+		s.push_back(c[k].coefficients());
+	return [s](double w) {
+		const auto z1 = std::polar(1.0, -w), z2 = z1 * z1;
+		cplx num = 1, den = 1;
+		for (auto [b0, b1, b2, a1, a2] : s) {
+			num *= b0 + b1 * z1 + b2 * z2;
+			den *= 1.0 + a1 * z1 + a2 * z2;
+		}
+		return num / den;
+	};
+}
+
+response
+section(const biquad_coefficients &c)
+{
+	return cascade(&c, 1);
+}
+
+response
+gain(double g)
+{
+	return [g](double) { return cplx{g}; };
+}
+
+response
+delay(double samples)
+{
+	return [samples](double w) { return std::polar(1.0, -w * samples); };
+}
+
+/*
+ * fft - transform 'x' in place, length must be a power of two
+ */
+void
+fft(std::vector<cplx> &x)
+{
+	const auto n = size(x);
+	for (size_t i = 1, j = 0; i < n; ++i) {
+		auto bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			std::swap(x[i], x[j]);
+	}
+	/* twiddles for the longest transform, shorter ones use a subset */
+	static std::vector<double> wr, wi;
+	if (size(wr) < n / 2) {
+		wr.resize(n / 2);
+		wi.resize(n / 2);
+		for (size_t k = 0; k < n / 2; ++k) {
+			wr[k] = std::cos(2 * pi * k / n);
+			wi[k] = -std::sin(2 * pi * k / n);
+		}
+	}
+	/* as doubles, std::complex arithmetic doesn't vectorise */
+	auto v = reinterpret_cast<double *>(data(x));
+	for (size_t len = 2; len <= n; len <<= 1) {
+		const auto half = len / 2, stride = 2 * size(wr) / len;
+		for (size_t i = 0; i < n; i += len) {
+			for (size_t k = 0; k < half; ++k) {
+				auto a = v + 2 * (i + k), c = a + 2 * half;
+				const auto tr = wr[k * stride];
+				const auto ti = wi[k * stride];
+				const auto br = c[0] * tr - c[1] * ti;
+				const auto bi = c[0] * ti + c[1] * tr;
+				c[0] = a[0] - br;
+				c[1] = a[1] - bi;
+				a[0] += br;
+				a[1] += bi;
+			}
+		}
+	}
+}
+
+/*
+ * fir - response of an impulse response
+ *
+ * Transformed once at long_length points, so only valid at the frequencies
+ * of those bins, which include those of every bin compared.
+ */
+response
+fir(const std::vector<double> &h)
+{
+	std::vector<cplx> x(long_length);
+	std::copy(begin(h), end(h), begin(x));
+	fft(x);
+	return [x = std::move(x)](double w) {
+		const auto i = std::lround(w * long_length / (2 * pi));
+		return x[i % long_length];
+	};
+}
+
+std::vector<cplx>
+transform(const std::vector<float> &x, size_t n)
+{
+	std::vector<cplx> y(n);
+	std::copy_n(begin(x), std::min(n, size(x)), begin(y));
+	fft(y);
+	return y;
+}
+
+/*
+ * tolerance - largest errors allowed in a response
+ *
+ * Only bins where the expected magnitude is within 'floor' dB of its peak
+ * are compared.
+ */
+struct tolerance {
+	double magnitude = 0.01;
+	double phase = 0.1;
+	double group_delay = 0.05;
+	double floor = -60;
+};
+
+/*
+ * float_tolerances - tolerances of the plugins with biquad filters when
+ * PO_BIQUAD_PRECISION=float forces single precision
+ *
+ * Rounding noise is largest relative to the response where that is far below
+ * its peak, so less of it is compared. Some speaker processor channels cut
+ * low frequencies before shaping them, where the noise of the later sections
+ * is never attenuated, see biquad_precision.
+ */
+const std::pair<const char *, tolerance> float_tolerances[] = {
+	{"butterworth", {.magnitude = 0.05, .phase = 0.5, .group_delay = 0.5,
+			 .floor = -40}},
+	{"linkwitz_riley", {.magnitude = 0.05, .phase = 0.5,
+			    .group_delay = 0.5, .floor = -40}},
+	{"crossover", {.magnitude = 0.5, .phase = 2, .group_delay = 3,
+		       .floor = -40}},
+	{"peaking", {.magnitude = 0.05, .phase = 0.5, .group_delay = 0.5,
+		     .floor = -40}},
+	{"low_shelf", {.magnitude = 0.05, .phase = 0.5, .group_delay = 0.5,
+		       .floor = -40}},
+	{"high_shelf", {.magnitude = 0.05, .phase = 0.5, .group_delay = 0.5,
+			.floor = -40}},
+	{"parametric_eq", {.magnitude = 0.05, .phase = 1, .group_delay = 1,
+			   .floor = -40}},
+	{"speaker_processor", {.magnitude = 0.5, .phase = 2,
+			       .group_delay = 2, .floor = -20}},
+};
+
+/*
+ * tolerance_of - tolerance 't' of the plugin called 'label', or its float
+ * tolerance if single precision is forced
+ */
+const tolerance &
+tolerance_of(const std::string &label, const tolerance &t)
+{
+	if (biquad_precision_from_env() != biquad_precision::float_tdf2)
+		return t;
+	for (auto &[prefix, f] : float_tolerances)
+		if (label.starts_with(prefix))
+			return f;
+	return t;
+}
+
+struct errors {
+	double magnitude = 0, phase = 0, group_delay = 0;
+
+	void add(const errors &e)
+	{
+		magnitude = std::max(magnitude, e.magnitude);
+		phase = std::max(phase, e.phase);
+		group_delay = std::max(group_delay, e.group_delay);
+	}
+
+	bool within(const tolerance &t) const
+	{
+		return magnitude <= t.magnitude && phase <= t.phase &&
+		       group_delay <= t.group_delay;
+	}
+};
+
+/*
+ * compare - compare measured bins 'first' to 'last' of an 'n' point
+ * transform with the expected response
+ *
+ * Compares up to 'points' bins spaced logarithmically across the range.
+ * Group delay error is the slope of the phase error across 1/512 of the
+ * sample rate, as the slope between adjacent bins would be mostly noise.
+ */
+errors
+compare(const std::vector<cplx> &measured, const response &expected,
+	size_t n, size_t first, size_t last, const tolerance &t)
+{
+	constexpr size_t points = 1024;
+	const auto span = n / 512;
+	const auto ratio = std::pow(double(last - span) / first, 1.0 / points);
+
+	std::vector<size_t> bins;
+	for (double f = first; f < last - span; f *= ratio) {
+		const auto i = size_t(f);
+		if (!empty(bins) && bins[size(bins) - 2] == i)
+			continue;
+		bins.push_back(i);
+		bins.push_back(i + span);
+	}
+	std::vector<cplx> e(size(bins));
+	double peak = 0;
+	for (size_t k = 0; k < size(bins); ++k) {
+		e[k] = expected(2 * pi * bins[k] / n);
+		peak = std::max(peak, std::abs(e[k]));
+	}
+	const auto floor = peak * std::pow(10, t.floor / 20);
+
+	errors r;
+	for (size_t k = 0; k < size(bins); k += 2) {
+		if (std::abs(e[k]) < floor || std::abs(e[k + 1]) < floor)
+			continue;
+		const auto a = measured[bins[k]] / e[k];
+		const auto b = measured[bins[k + 1]] / e[k + 1];
+		r.magnitude = std::max(r.magnitude,
+				       std::abs(20 * std::log10(std::abs(a))));
+		r.phase = std::max(r.phase, std::abs(std::arg(a)) * 180 / pi);
+		r.group_delay = std::max(r.group_delay,
+					 std::abs(std::arg(b * std::conj(a))) /
+					 (2 * pi * span / n));
+	}
+	return r;
+}
+
+/*
+ * plugin - an instance of a plugin and the ports it has
+ *
+ * Output j belongs to channel owner(j), the input before it. In place, the
+ * first output after each input shares the input's buffer.
+ */
+class plugin {
+public:
+	explicit plugin(const LADSPA_Descriptor *d)
+	: d_{d}, controls_(d->PortCount)
+	{
+		h_ = d->instantiate(d, rate);
+		for (unsigned long p = 0; p < d->PortCount; ++p) {
+			const auto pd = d->PortDescriptors[p];
+			if (LADSPA_IS_PORT_CONTROL(pd))
+				d->connect_port(h_, p, &controls_[p]);
+			else if (LADSPA_IS_PORT_INPUT(pd))
+				inputs_.push_back(p);
+			else {
+				outputs_.push_back(p);
+				owner_.push_back(size(inputs_) - 1);
+			}
+		}
+	}
+
+	~plugin()
+	{
+		d_->cleanup(h_);
+	}
+
+	/* set the control input called 'name', returns false if none is */
+	bool set(const std::string &name, LADSPA_Data v)
+	{
+		auto p = port(name);
+		if (p < 0 || !LADSPA_IS_PORT_INPUT(d_->PortDescriptors[p]))
+			return false;
+		controls_[p] = v;
+		return true;
+	}
+
+	/* value of the control output called 'name', or 0 if none is */
+	LADSPA_Data get(const std::string &name) const
+	{
+		auto p = port(name);
+		return p < 0 ? 0 : controls_[p];
+	}
+
+	size_t outputs() const
+	{
+		return size(outputs_);
+	}
+
+	size_t owner(size_t output) const
+	{
+		return owner_[output];
+	}
+
+	void activate()
+	{
+		if (d_->activate)
+			d_->activate(h_);
+	}
+
+	/*
+	 * process - run 'input' through the plugin in blocks of 'blocks'
+	 * samples in turn, storing to 'output' which run_adding adds to
+	 */
+	void process(const std::vector<std::vector<float>> &input,
+		     std::vector<std::vector<float>> &output, bool in_place,
+		     bool adding, const size_t *blocks, size_t nblocks)
+	{
+		const auto samples = size(input[0]);
+		std::vector<float *> in;
+		std::vector<bool> shared(size(outputs_));
+		for (size_t c = 0; c < size(inputs_); ++c)
+			in.push_back(const_cast<float *>(data(input[c])));
+		if (in_place) {
+			for (size_t j = 0; j < size(outputs_); ++j) {
+				if (j && owner_[j] == owner_[j - 1])
+					continue;
+				output[j] = input[owner_[j]];
+				in[owner_[j]] = data(output[j]);
+				shared[j] = true;
+			}
+		}
+		if (adding)
+			d_->set_run_adding_gain(h_, adding_gain);
+
+		for (size_t i = 0, k = 0, len; i < samples; i += len) {
+			len = std::min(samples - i, blocks[k++ % nblocks]);
+			for (size_t c = 0; c < size(inputs_); ++c)
+				d_->connect_port(h_, inputs_[c], in[c] + i);
+			for (size_t j = 0; j < size(outputs_); ++j)
+				d_->connect_port(h_, outputs_[j],
+						 data(output[j]) + i);
+			if (adding)
+				d_->run_adding(h_, len);
+			else
+				d_->run(h_, len);
+		}
+	}
+
+private:
+	long port(const std::string &name) const
+	{
+		for (unsigned long p = 0; p < d_->PortCount; ++p)
+			if (name == d_->PortNames[p])
+				return p;
+		return -1;
+	}
+
+	const LADSPA_Descriptor *d_;
+	LADSPA_Handle h_;
+	std::vector<LADSPA_Data> controls_;
+	std::vector<unsigned long> inputs_, outputs_;
+	std::vector<size_t> owner_;
+};
+
+const LADSPA_Descriptor *
+find(const std::string &label)
+{
+	const LADSPA_Descriptor *d;
+	for (unsigned long i = 0; (d = descriptors(i)); ++i)
+		if (label == d->Label)
+			return d;
+	return nullptr;
+}
+
+/* input scale of each channel */
+double
+scale(size_t channel)
+{
+	return 1 - channel / 16.0;
+}
+
+/*
+ * sweep - exponential sine sweep of 'n' samples from 20Hz to 20kHz with
+ * 10ms fades
+ */
+std::vector<float>
+sweep(size_t n)
+{
+	const size_t fade = rate / 100;
+	const auto f0 = 20.0, f1 = 20000.0;
+	const auto k = std::log(f1 / f0);
+	std::vector<float> x(n);
+	for (size_t i = 0; i < n; ++i) {
+		const auto t = double(i) / n;
+		auto g = 0.5;
+		if (i < fade)
+			g *= double(i) / fade;
+		if (n - i < fade)
+			g *= double(n - i) / fade;
+		x[i] = g * std::sin(2 * pi * f0 * n / rate / k *
+				    (std::exp(t * k) - 1));
+	}
+	return x;
+}
+
+using controls = std::vector<std::pair<std::string, LADSPA_Data>>;
+
+/*
+ * expectation - expected response of output 'band' of 'channel', with the
+ * latency the plugin reports
+ */
+using expectation =
+	std::function<response(size_t channel, size_t band, double latency)>;
+
+/* check if 'label' starts with one of the labels given, or none were */
+bool
+selected(const std::string &label)
+{
+	if (empty(labels))
+		return true;
+	for (auto &l : labels)
+		if (label.starts_with(l))
+			return true;
+	return false;
+}
+
+/*
+ * check - measure a plugin with 'c' controls and compare its outputs with
+ * 'expected'
+ *
+ * Runs and transforms 'length' samples of each signal. The sweep takes half
+ * of them, leaving the rest for its response to decay.
+ */
+void
+check(const std::string &label, const std::string &settings,
+      const controls &c, const expectation &expected,
+      const tolerance &given = {}, size_t length = short_length)
+{
+	if (!selected(label))
+		return;
+	const auto &t = tolerance_of(label, given);
+	auto d = find(label);
+	if (!d) {
+		printf("%-36s %-30s no such plugin  FAIL\n", label.c_str(),
+		       settings.c_str());
+		ok = false;
+		return;
+	}
+
+	plugin run{d}, add{d}, swept{d};
+	for (auto &[name, v] : c) {
+		if (run.set(name, v) && add.set(name, v) &&
+		    swept.set(name, v))
+			continue;
+		printf("%-36s %-30s no port '%s'  FAIL\n", label.c_str(),
+		       settings.c_str(), name.c_str());
+		ok = false;
+		return;
+	}
+	run.activate();
+	add.activate();
+	swept.activate();
+
+	const auto outputs = run.outputs();
+	const auto channels = run.owner(outputs - 1) + 1;
+	std::vector<std::vector<float>> x(channels), y(outputs), z(outputs);
+	for (size_t ch = 0; ch < channels; ++ch) {
+		x[ch].assign(length, 0);
+		x[ch][0] = scale(ch);
+	}
+	for (size_t j = 0; j < outputs; ++j) {
+		y[j].assign(length, 0);
+		/* something to add to */
+		z[j].assign(length, 0);
+		for (size_t i = 0; i < length; ++i)
+			z[j][i] = 0.25f * std::sin(0.01 * i + j);
+	}
+	const auto before = z;
+	run.process(x, y, false, false, &impulse_block, 1);
+	add.process(x, z, false, true, &impulse_block, 1);
+
+	const auto sw = sweep(length / 2);
+	for (size_t ch = 0; ch < channels; ++ch) {
+		x[ch].assign(length, 0);
+		for (size_t i = 0; i < size(sw); ++i)
+			x[ch][i] = sw[i] * scale(ch);
+	}
+	std::vector<std::vector<float>> s(outputs, std::vector<float>(length));
+	swept.process(x, s, true, false, sweep_blocks, std::size(sweep_blocks));
+	const auto sx = transform(sw, length);
+	const auto lo = size_t(30.0 * length / rate);
+	const auto hi = size_t(16000.0 * length / rate);
+
+	const double latency = run.get("latency");
+	errors impulse, swept_errors;
+	double adding = 0;
+	for (size_t j = 0; j < outputs; ++j) {
+		/* bands of each channel are numbered in order */
+		const auto ch = run.owner(j);
+		size_t band = 0;
+		while (band < j && run.owner(j - band - 1) == ch)
+			++band;
+		const auto h = expected(ch, band, latency);
+
+		auto m = transform(y[j], length);
+		for (auto &v : m)
+			v /= scale(ch);
+		impulse.add(compare(m, h, length, 1, length / 2, t));
+
+		auto sy = transform(s[j], length);
+		for (size_t i = lo; i < hi; ++i)
+			sy[i] /= sx[i] * scale(ch);
+		swept_errors.add(compare(sy, h, length, lo, hi, t));
+
+		/* relative to the largest sample added */
+		double peak = 0, error = 0;
+		for (size_t i = 0; i < length; ++i) {
+			peak = std::max<double>({peak, std::abs(y[j][i]),
+						 std::abs(before[j][i])});
+			error = std::max<double>(error,
+			    std::abs(z[j][i] - before[j][i] -
+				     adding_gain * y[j][i]));
+		}
+		adding = std::max(adding, error / peak);
+	}
+
+	errors worst = impulse;
+	worst.add(swept_errors);
+	const auto pass = impulse.within(t) && swept_errors.within(t) &&
+			  adding < 1e-6;
+	printf("%-36s %-30s %9.2e %9.2e %9.2e %9.2e%s\n", label.c_str(),
+	       settings.c_str(), worst.magnitude, worst.phase,
+	       worst.group_delay, adding, pass ? "" : "  FAIL");
+	ok &= pass;
+}
+
+/* printf to a string */
+template<typename... T>
+std::string
+format(const char *f, T... v)
+{
+	char s[64];
+	snprintf(s, sizeof(s), f, v...);
+	return s;
+}
+
+std::string
+channels_label(const std::string &family, size_t channels)
+{
+	return family + "_" + std::to_string(channels) + "ch";
+}
+
+constexpr size_t channel_counts[] = {1, 3, 8};
+
+/*
+ * designs - check biquad_coefficients designs against closed forms
+ */
+void
+designs()
+{
+	const double fs = rate, f0 = 1000;
+	auto w = [&](double f) { return 2 * pi * f / fs; };
+	auto mag = [&](const response &h, double f) {
+		return std::abs(h(w(f)));
+	};
+	/* analog frequency relative to f0 after the bilinear transform */
+	auto warp = [&](double f) {
+		return std::tan(pi * f / fs) / std::tan(pi * f0 / fs);
+	};
+	const double freqs[] = {20, 200, 999, 1000, 1001, 5000, 20000};
+
+	double worst = 0;
+	auto expect = [&](double got, double want) {
+		worst = std::max(worst, std::abs(got - want) /
+					std::max(std::abs(want), 1e-3));
+	};
+	auto report = [&](const char *name) {
+		const auto pass = worst < 1e-9;
+		printf("%-36s %-30s %9.2e%s\n", "design", name, worst,
+		       pass ? "" : "  FAIL");
+		ok &= pass;
+		worst = 0;
+	};
+
+	std::array<biquad_coefficients, 8> c;
+	for (unsigned order = 1; order <= 16; ++order) {
+		auto lp = cascade(data(c),
+				  butterworth_lowpass(data(c), order, f0, fs));
+		auto hp = cascade(data(c),
+				  butterworth_highpass(data(c), order, f0, fs));
+		auto ap = cascade(data(c),
+				  butterworth_allpass(data(c), order, f0, fs));
+		for (auto f : freqs) {
+			const auto t = std::pow(warp(f), 2 * order);
+			expect(mag(lp, f), std::sqrt(1 / (1 + t)));
+			expect(mag(hp, f), std::sqrt(t / (1 + t)));
+			expect(mag(ap, f), 1);
+		}
+	}
+	report("butterworth, orders 1 to 16");
+
+	for (unsigned order = 2; order <= 16; order += 2) {
+		auto lp = cascade(data(c), linkwitz_riley_lowpass(
+			data(c), order, f0, fs));
+		auto hp = cascade(data(c), linkwitz_riley_highpass(
+			data(c), order, f0, fs));
+		const auto sign = order / 2 % 2 ? -1.0 : 1.0;
+		for (auto f : freqs) {
+			const auto t = std::pow(warp(f), order);
+			expect(mag(lp, f), 1 / (1 + t));
+			expect(mag(hp, f), t / (1 + t));
+			expect(std::abs(lp(w(f)) + sign * hp(w(f))), 1);
+		}
+	}
+	report("linkwitz riley, orders 2 to 16");
+
+	const double gains[] = {-10, 6};
+	const double qs[] = {0.5, 0.7071, 4};
+	for (auto g : gains) {
+		for (auto q : qs) {
+			const auto a = std::pow(10, g / 20);
+			biquad_coefficients b;
+			b.peaking_eq(f0, g, q, fs);
+			expect(mag(section(b), 0), 1);
+			expect(mag(section(b), f0), a);
+			expect(mag(section(b), fs / 2), 1);
+			b.low_shelf(f0, g, q, fs);
+			expect(mag(section(b), 0), a);
+			expect(mag(section(b), f0), std::sqrt(a));
+			expect(mag(section(b), fs / 2), 1);
+			b.high_shelf(f0, g, q, fs);
+			expect(mag(section(b), 0), 1);
+			expect(mag(section(b), f0), std::sqrt(a));
+			expect(mag(section(b), fs / 2), a);
+		}
+	}
+	report("peaking & shelving gains");
+
+	for (auto q : qs) {
+		biquad_coefficients b;
+		b.lpf(f0, q, fs);
+		expect(mag(section(b), 0), 1);
+		expect(mag(section(b), f0), q);
+		expect(mag(section(b), fs / 2), 0);
+		b.hpf(f0, q, fs);
+		expect(mag(section(b), 0), 0);
+		expect(mag(section(b), f0), q);
+		expect(mag(section(b), fs / 2), 1);
+		b.apf(f0, q, fs);
+		for (auto f : freqs)
+			expect(mag(section(b), f), 1);
+	}
+	biquad_coefficients b;
+	b.lpf1(f0, fs);
+	expect(mag(section(b), f0), std::sqrt(0.5));
+	b.hpf1(f0, fs);
+	expect(mag(section(b), f0), std::sqrt(0.5));
+	b.apf1(f0, fs);
+	for (auto f : freqs)
+		expect(mag(section(b), f), 1);
+	report("lowpass, highpass & allpass");
+}
+
+/*
+ * filters - single filters designed by one function
+ */
+void
+filters()
+{
+	for (auto high : {false, true}) {
+		const std::string family = high ? "butterworth_highpass"
+						: "butterworth_lowpass";
+		for (auto channels : channel_counts) {
+			/* 1 to 8 sections, odd and even orders */
+			for (unsigned order : {1, 4, 5, 8, 9, 12, 13, 16}) {
+				std::array<biquad_coefficients, 8> c;
+				auto n = (high ? butterworth_highpass
+					       : butterworth_lowpass)(
+				    data(c), order, 1000, rate,
+				    biquad_design::exact);
+				const auto h = cascade(data(c), n);
+				check(channels_label(family, channels),
+				      "order " + std::to_string(order),
+				      {{"Cutoff Frequency (Hz)", 1000},
+				       {"Order", order}},
+				      [&](size_t, size_t, double) {
+					      return h;
+				      });
+			}
+		}
+	}
+
+	for (auto high : {false, true}) {
+		const std::string family = high ? "linkwitz_riley_highpass"
+						: "linkwitz_riley_lowpass";
+		for (auto channels : channel_counts) {
+			for (unsigned order = 2; order <= 16; order += 2) {
+				std::array<biquad_coefficients, 8> c;
+				auto n = (high ? linkwitz_riley_highpass
+					       : linkwitz_riley_lowpass)(
+				    data(c), order, 1000, rate,
+				    biquad_design::exact);
+				const auto h = cascade(data(c), n);
+				check(channels_label(family, channels),
+				      "order " + std::to_string(order),
+				      {{"Crossover Frequency (Hz)", 1000},
+				       {"Order", order}},
+				      [&](size_t, size_t, double) {
+					      return h;
+				      });
+			}
+		}
+	}
+
+	using design = void (biquad_coefficients::*)(double, double, double,
+						       double, biquad_design);
+	const std::pair<const char *, design> single[] = {
+		{"peaking", &biquad_coefficients::peaking_eq},
+		{"low_shelf", &biquad_coefficients::low_shelf},
+		{"high_shelf", &biquad_coefficients::high_shelf},
+	};
+	const std::array<double, 3> settings[] = {
+		{1000, -10, 0.7071},
+		{200, 6, 4},
+	};
+	for (auto [family, fn] : single) {
+		for (auto channels : channel_counts) {
+			for (auto [f0, g, q] : settings) {
+				biquad_coefficients b;
+				(b.*fn)(f0, g, q, rate, biquad_design::exact);
+				const auto h = section(b);
+				check(channels_label(family, channels),
+				      format("%gHz %gdB Q %g", f0, g, q),
+				      {{"Centre Frequency (Hz)", f0},
+				       {"Gain (dB)", g},
+				       {"Bandwidth (Q)", q}},
+				      [&](size_t, size_t, double) {
+					      return h;
+				      });
+			}
+		}
+	}
+}
+
+/*
+ * band - settings of an eq band and its expected response
+ */
+struct band {
+	int type;
+	double f0, gain, q;
+
+	response expected() const
+	{
+		biquad_coefficients b;
+		switch (type) {
+		case 1:
+			b.peaking_eq(f0, gain, q, rate);
+			break;
+		case 2:
+			b.low_shelf(f0, gain, q, rate);
+			break;
+		case 3:
+			b.high_shelf(f0, gain, q, rate);
+			break;
+		case 4:
+			b.lpf(f0, q, rate);
+			break;
+		case 5:
+			b.hpf(f0, q, rate);
+			break;
+		default:
+			return ::gain(1);
+		}
+		return section(b);
+	}
+
+	void add(controls &c, const std::string &prefix) const
+	{
+		c.emplace_back(prefix + " Type", type);
+		c.emplace_back(prefix + " Frequency (Hz)", f0);
+		c.emplace_back(prefix + " Gain (dB)", gain);
+		c.emplace_back(prefix + " Bandwidth (Q)", q);
+	}
+};
+
+/* band k of 'bands', every type and one which is off */
+band
+eq_band(size_t k, size_t bands)
+{
+	return {int(k % 6), 40 * std::pow(2, 9.0 * k / bands),
+		k % 2 ? -6.0 : 4.0, 0.7 + 0.3 * (k % 4)};
+}
+
+/*
+ * equalisers - parametric eq and speaker processor
+ */
+void
+equalisers()
+{
+	for (size_t bands : {4, 8, 16}) {
+		const auto family = "parametric_eq_" + std::to_string(bands) +
+				    "band";
+		controls c;
+		response h = gain(1);
+		for (size_t k = 0; k < bands; ++k) {
+			const auto b = eq_band(k, bands);
+			b.add(c, "Band " + std::to_string(k + 1));
+			h = h * b.expected();
+		}
+		for (auto channels : channel_counts)
+			check(channels_label(family, channels), "every type", c,
+			      [&](size_t, size_t, double) { return h; });
+	}
+
+	/* a different chain on every channel */
+	for (auto channels : channel_counts) {
+		controls c;
+		std::vector<response> h;
+		for (size_t ch = 0; ch < channels; ++ch) {
+			const auto prefix = "Channel " + std::to_string(ch + 1);
+			const double f0 = 40 + 10 * ch;
+			const unsigned order = ch % 5;
+			const double g = -3.0 + ch;
+			const bool invert = ch % 2;
+			const float ms = 0.5 * ch;
+			c.emplace_back(prefix + " Highpass Frequency (Hz)", f0);
+			c.emplace_back(prefix + " Highpass Order (0 to 16)",
+				       order);
+			std::array<biquad_coefficients, 8> hpf;
+			auto r = cascade(data(hpf), butterworth_highpass(
+				data(hpf), order, f0, rate));
+			for (size_t k = 0; k < 8; ++k) {
+				auto b = eq_band((k + ch) % 8, 8);
+				b.add(c, prefix + " Band " +
+					 std::to_string(k + 1));
+				r = r * b.expected();
+			}
+			c.emplace_back(prefix + " Gain (dB)", g);
+			c.emplace_back(prefix + " Invert Polarity", invert);
+			c.emplace_back(prefix + " Delay (ms)", ms);
+			h.push_back(r * gain(std::pow(10, g / 20) *
+					     (invert ? -1 : 1)) *
+				    delay(std::round(ms / 1000.0 * rate)));
+		}
+		check(channels_label("speaker_processor", channels),
+		      "chain per channel", c,
+		      [&](size_t ch, size_t, double) { return h[ch]; });
+	}
+}
+
+/*
+ * split - expected bands of a Linkwitz Riley crossover tree
+ *
+ * Band k is the lowpass of split k after the highpasses of the splits below
+ * it, and each band below the last is followed by the allpass of every split
+ * above it. Highpasses are inverted when half the order is odd.
+ */
+std::vector<response>
+split(const std::vector<double> &f, unsigned order)
+{
+	std::vector<response> lp, hp, ap;
+	for (auto f0 : f) {
+		std::array<biquad_coefficients, 8> c;
+		lp.push_back(cascade(data(c), linkwitz_riley_lowpass(
+			data(c), order, f0, rate)));
+		hp.push_back(cascade(data(c), linkwitz_riley_highpass(
+			data(c), order, f0, rate)) *
+			     gain(order / 2 % 2 ? -1 : 1));
+		ap.push_back(cascade(data(c), butterworth_allpass(
+			data(c), order / 2, f0, rate)));
+	}
+	std::vector<response> bands;
+	response rest = gain(1);
+	for (size_t k = 0; k < size(f); ++k) {
+		auto b = rest * lp[k];
+		for (size_t j = k + 1; j < size(f); ++j)
+			b = b * ap[j];
+		bands.push_back(b);
+		rest = rest * hp[k];
+	}
+	bands.push_back(rest);
+	return bands;
+}
+
+/*
+ * linear_phase - zero phase Linkwitz Riley magnitudes of each band
+ */
+std::vector<response>
+linear_phase(const std::vector<double> &f, unsigned order)
+{
+	std::vector<response> bands;
+	for (size_t k = 0; k <= size(f); ++k) {
+		bands.push_back([f, order, k](double w) {
+			const auto hz = w * rate / (2 * pi);
+			double rest = 1;
+			for (size_t j = 0; j < size(f); ++j) {
+				const auto r = std::pow(hz / f[j], order);
+				if (j == k)
+					return cplx{rest / (1 + r)};
+				rest *= r / (1 + r);
+			}
+			return cplx{rest};
+		});
+	}
+	return bands;
+}
+
+/*
+ * crossovers - Linkwitz Riley and linear phase crossovers
+ */
+void
+crossovers()
+{
+	const std::vector<double> splits[] = {
+		{1000},
+		{300, 3000},
+		{200, 1000, 5000},
+	};
+	for (auto &f : splits) {
+		const auto ways = std::to_string(size(f) + 1) + "way";
+		controls c;
+		for (size_t k = 0; k < size(f); ++k)
+			c.emplace_back(size(f) == 1 ? "Crossover Frequency (Hz)"
+			    : "Crossover Frequency " + std::to_string(k + 1) +
+			      " (Hz)", f[k]);
+		for (unsigned order : {2, 4, 6, 8}) {
+			auto oc = c;
+			oc.emplace_back("Order", order);
+			const auto iir = split(f, order);
+			const auto fir = linear_phase(f, order);
+			const auto name = "order " + std::to_string(order);
+			for (auto channels : channel_counts)
+				check(channels_label("crossover_" + ways,
+						     channels),
+				      name, oc,
+				      [&](size_t, size_t b, double) {
+					      return iir[b];
+				      });
+			/*
+			 * the filters differ only in the magnitudes they are
+			 * designed from, and each channel is convolved alone,
+			 * so the slowest and sharpest at two channel counts
+			 * are enough. Windowing smooths the magnitudes.
+			 */
+			if (order != 2 && order != 8)
+				continue;
+			for (size_t channels : {1, 3})
+				check(channels_label(
+					  "linear_phase_crossover_" + ways,
+					  channels),
+				      name, oc,
+				      [&](size_t, size_t b, double latency) {
+					      return fir[b] * delay(latency);
+				      },
+				      {.magnitude = 0.2, .phase = 0.5,
+				       .group_delay = 0.05, .floor = -40},
+				      long_length);
+		}
+	}
+}
+
+/*
+ * write_wav - write a 32 bit float WAV file, padding short channels with
+ * silence
+ */
+bool
+write_wav(const char *path, const std::vector<std::vector<double>> &x)
+{
+	auto f = fopen(path, "wb");
+	if (!f)
+		return false;
+	const uint32_t channels = size(x);
+	uint32_t frames = 0;
+	for (auto &c : x)
+		frames = std::max<uint32_t>(frames, size(c));
+	const uint32_t bytes = channels * frames * 4;
+	auto u32 = [&](uint32_t v) { fwrite(&v, 4, 1, f); };
+	auto u16 = [&](uint16_t v) { fwrite(&v, 2, 1, f); };
+	fwrite("RIFF", 4, 1, f);
+	u32(36 + bytes);
+	fwrite("WAVEfmt ", 8, 1, f);
+	u32(16);
+	u16(3);
+	u16(channels);
+	u32(rate);
+	u32(rate * channels * 4);
+	u16(channels * 4);
+	u16(32);
+	fwrite("data", 4, 1, f);
+	u32(bytes);
+	for (size_t i = 0; i < frames; ++i) {
+		for (auto &c : x) {
+			const float v = i < size(c) ? c[i] : 0;
+			fwrite(&v, 4, 1, f);
+		}
+	}
+	return !fclose(f);
+}
+
+/*
+ * others - delays, gains and convolution
+ */
+void
+others()
+{
+	for (auto channels : channel_counts) {
+		for (float ms : {0.0f, 0.5f, 5.0f}) {
+			const auto d = std::round(ms / 1000.0 * rate);
+			check(channels_label("delay", channels),
+			      format("%gms", ms), {{"Delay (ms)", ms}},
+			      [&](size_t, size_t, double) {
+				      return delay(d);
+			      });
+		}
+
+		/* third order Lagrange interpolation at x in [1, 2) */
+		const float ms = 1.2345f;
+		const double d = ms / 1000.0 * rate;
+		const auto whole = std::floor(d) - 1;
+		const auto x = d - whole;
+		std::vector<double> h(4);
+		for (int k = 0; k < 4; ++k) {
+			h[k] = 1;
+			for (int m = 0; m < 4; ++m)
+				if (m != k)
+					h[k] *= (x - m) / (k - m);
+		}
+		check(channels_label("fractional_delay", channels),
+		      format("%gms", ms), {{"Delay (ms)", ms}},
+		      [&](size_t, size_t, double) {
+			      return fir(h) * delay(whole);
+		      });
+
+		for (float g : {-10.0f, 6.0f})
+			check(channels_label("gain", channels),
+			      format("%gdB", g), {{"Gain (dB)", g}},
+			      [&](size_t, size_t, double) {
+				      return gain(std::pow(10, g / 20.0));
+			      });
+		check(channels_label("invert", channels), "", {},
+		      [&](size_t, size_t, double) { return gain(-1); });
+	}
+
+	/* decaying noise, with the tail of the longer channel convolved by
+	 * the background thread */
+	std::vector<std::vector<double>> ir{std::vector<double>(3000),
+					    std::vector<double>(10000)};
+	unsigned seed = 1;
+	for (auto &c : ir) {
+		for (size_t i = 0; i < size(c); ++i) {
+			seed = seed * 1103515245 + 12345;
+			const auto n = (seed >> 8 & 0xffff) / 32768.0 - 1;
+			c[i] = n * std::exp(-6.0 * i / size(c));
+		}
+	}
+	char path[] = "/tmp/po-plugins-check-XXXXXX";
+	auto fd = mkstemp(path);
+	if (fd < 0 || close(fd) || !write_wav(path, ir)) {
+		printf("%-36s cannot write %s  FAIL\n", "convolver", path);
+		ok = false;
+		return;
+	}
+	setenv("PO_CONVOLVER_IR", path, 1);
+	for (auto channels : channel_counts)
+		check(channels_label("convolver", channels), "2 channel IR", {},
+		      [&](size_t ch, size_t, double latency) {
+			      return fir(ir[ch % 2]) * delay(latency);
+		      }, {}, long_length);
+	unsetenv("PO_CONVOLVER_IR");
+	unlink(path);
+}
+
+/*
+ * retune - change the controls of a plugin from 'from' to 'to' as it runs
+ *
+ * Runs noise through an instance set up with 'from' in blocks of 256 samples,
+ * sets 'to' a quarter of a second in and runs on for another second and a
+ * quarter. Its output must stay within 'bound' times the peak output of
+ * either setting, and over the last 4096 samples must match an instance
+ * set up with 'to' from the start, over 'from' for controls 'to' leaves out,
+ * to within -80dB of its peak, or -40dB when single precision is forced and
+ * the two reach different rounding noise. Then input stops, and once the
+ * tail has passed the idle port must read 1 and the output must be silent.
+ *
+ * With 'paced', blocks are run no faster than every 100us so that background
+ * threads keep up as they would with a real time host. With 'reactivate' the
+ * instance is activated again half a second in, as hosts must do to apply
+ * longer delays than the plugin has committed memory for.
+ */
+void
+retune(const std::string &label, const std::string &settings,
+       const controls &from, const controls &to, double bound = 2,
+       bool paced = false, bool reactivate = false)
+{
+	if (!selected(label))
+		return;
+	auto d = find(label);
+	if (!d) {
+		printf("%-36s %-30s no such plugin  FAIL\n", label.c_str(),
+		       settings.c_str());
+		ok = false;
+		return;
+	}
+
+	plugin live{d}, before{d}, after{d};
+	for (auto [p, c] : {std::pair{&live, &from}, {&before, &from},
+			    {&after, &from}, {&after, &to}}) {
+		for (auto &[name, v] : *c) {
+			if (p->set(name, v))
+				continue;
+			printf("%-36s %-30s no port '%s'  FAIL\n",
+			       label.c_str(), settings.c_str(), name.c_str());
+			ok = false;
+			return;
+		}
+	}
+	live.activate();
+	before.activate();
+	after.activate();
+
+	constexpr size_t block = 256;
+	/* changes fall between blocks */
+	constexpr size_t change = rate / 4 / block * block;
+	constexpr size_t reactivation = 2 * change;
+	constexpr size_t length = 6 * change, window = 4096;
+	constexpr size_t tail = 2 * rate;
+	const auto outputs = live.outputs();
+	const auto channels = live.owner(outputs - 1) + 1;
+	unsigned seed = 1;
+	std::vector<std::vector<float>> x(channels, std::vector<float>(block));
+	std::vector<std::vector<float>> y(outputs, std::vector<float>(block));
+	auto b = y, a = y;
+	double peak = 0, reference = 0, error = 0, settled = 0;
+	for (size_t i = 0; i < length + tail; i += block) {
+		for (size_t ch = 0; ch < channels; ++ch) {
+			for (auto &v : x[ch]) {
+				seed = seed * 1103515245 + 12345;
+				const auto n = (seed >> 8 & 0xffff) / 32768.0 - 1;
+				v = i < length ? 0.5 * n * scale(ch) : 0;
+			}
+		}
+		if (i == change) {
+			for (auto &[name, v] : to)
+				live.set(name, v);
+		}
+		if (reactivate && i == reactivation)
+			live.activate();
+		live.process(x, y, false, false, &block, 1);
+		before.process(x, b, false, false, &block, 1);
+		after.process(x, a, false, false, &block, 1);
+		if (paced)
+			usleep(100);
+
+		for (size_t j = 0; j < outputs; ++j) {
+			for (size_t k = 0; k < block; ++k) {
+				peak = std::max<double>(peak, std::abs(y[j][k]));
+				reference = std::max<double>({reference,
+				    std::abs(b[j][k]), std::abs(a[j][k])});
+				if (i + k < length - window || i + k >= length)
+					continue;
+				settled = std::max<double>(settled,
+							   std::abs(a[j][k]));
+				error = std::max<double>(error,
+				    std::abs(y[j][k] - a[j][k]));
+			}
+		}
+	}
+	auto silent = true;
+	for (auto &o : y)
+		for (auto v : o)
+			silent &= v == 0;
+
+	const auto ratio = peak / reference;
+	const auto relative = error / settled;
+	const auto within = biquad_precision_from_env() ==
+			    biquad_precision::float_tdf2 ? 1e-2 : 1e-4;
+	const auto pass = ratio <= bound && relative <= within && silent &&
+			  live.get("Idle") == 1;
+	printf("%-36s %-30s %9.2e %9.2e %9s%s\n", label.c_str(),
+	       settings.c_str(), ratio, relative,
+	       silent ? "silent" : "sound", pass ? "" : "  FAIL");
+	ok &= pass;
+}
+
+/*
+ * live - controls changed while plugins run
+ */
+void
+live()
+{
+	printf("%-36s %-30s %9s %9s %9s\n", "label", "retuned", "peak",
+	       "settled", "idle");
+
+	/* bands switched off still pass the signal once drained */
+	controls on, off;
+	for (size_t k = 0; k < 4; ++k) {
+		const auto prefix = "Band " + std::to_string(k + 1);
+		band{1, 250.0 * (k + 1), 6, 1}.add(on, prefix);
+		off.emplace_back(prefix + " Type", 0);
+	}
+	retune("parametric_eq_4band_1ch", "bands off", on, off);
+	controls speaker_on, speaker_off;
+	for (auto &[name, v] : on)
+		speaker_on.emplace_back("Channel 1 " + name, v);
+	for (auto &[name, v] : off)
+		speaker_off.emplace_back("Channel 1 " + name, v);
+	retune("speaker_processor_1ch", "bands off", speaker_on, speaker_off);
+
+	/* eq bands keep their state as highpass sections come and go, which
+	 * themselves start from state left by another order */
+	auto hpf = speaker_on;
+	hpf.emplace_back("Channel 1 Highpass Frequency (Hz)", 40);
+	for (auto [a, b] : {std::pair{0, 4}, {4, 16}, {16, 1}}) {
+		auto from = hpf;
+		from.emplace_back("Channel 1 Highpass Order (0 to 16)", a);
+		retune("speaker_processor_1ch",
+		       format("highpass order %d to %d", a, b), from,
+		       {{"Channel 1 Highpass Order (0 to 16)", b}}, 4);
+	}
+
+	/* filters ramp to new frequencies and gains, and crossfade to new
+	 * orders */
+	for (auto label : {"butterworth_lowpass_1ch", "butterworth_highpass_1ch"})
+		retune(label, "cutoff and order",
+		       {{"Cutoff Frequency (Hz)", 1000}, {"Order", 2}},
+		       {{"Cutoff Frequency (Hz)", 3000}, {"Order", 5}});
+	for (auto label : {"linkwitz_riley_lowpass_1ch",
+			   "linkwitz_riley_highpass_1ch", "crossover_2way_2ch"})
+		retune(label, "frequency and order",
+		       {{"Crossover Frequency (Hz)", 1000}, {"Order", 2}},
+		       {{"Crossover Frequency (Hz)", 300}, {"Order", 8}});
+	retune("crossover_4way_1ch", "frequencies and order",
+	       {{"Crossover Frequency 1 (Hz)", 200},
+		{"Crossover Frequency 2 (Hz)", 2000},
+		{"Crossover Frequency 3 (Hz)", 8000}, {"Order", 4}},
+	       {{"Crossover Frequency 1 (Hz)", 100},
+		{"Crossover Frequency 2 (Hz)", 1000},
+		{"Crossover Frequency 3 (Hz)", 4000}, {"Order", 6}});
+	for (auto label : {"peaking_1ch", "low_shelf_1ch", "high_shelf_1ch"})
+		retune(label, "frequency, gain and Q",
+		       {{"Centre Frequency (Hz)", 500}, {"Gain (dB)", 6},
+			{"Bandwidth (Q)", 1}},
+		       {{"Centre Frequency (Hz)", 2000}, {"Gain (dB)", -12},
+			{"Bandwidth (Q)", 0.5}});
+	controls types, moved;
+	for (size_t k = 0; k < 4; ++k) {
+		const auto prefix = "Band " + std::to_string(k + 1);
+		band{static_cast<int>(k + 2), 500.0 * (k + 1), -6, 2}.add(
+		    moved, prefix);
+		types.emplace_back(prefix + " Type", k + 2);
+	}
+	/* types switch without a ramp */
+	retune("parametric_eq_4band_1ch", "band types", on, types, 4);
+	retune("parametric_eq_4band_1ch", "band controls", on, moved);
+	retune("parametric_eq_4band_1ch", "bands on", off, on);
+
+	/* the linear phase crossover designs on a worker and crossfades once
+	 * the design is ready */
+	retune("linear_phase_crossover_3way_1ch", "frequencies and order",
+	       {{"Crossover Frequency 1 (Hz)", 300},
+		{"Crossover Frequency 2 (Hz)", 3000}, {"Order", 4}},
+	       {{"Crossover Frequency 1 (Hz)", 150},
+		{"Crossover Frequency 2 (Hz)", 1500}, {"Order", 8}},
+	       2, true);
+
+	/* delays crossfade within the capacity of their lines, longer ones
+	 * wait for the plugin to be activated again */
+	for (auto label : {"delay_1ch", "fractional_delay_1ch"}) {
+		for (auto [a, b] : {std::pair{0.5, 5.25}, {5.25, 0.0},
+				    {0.0, 2.0}})
+			retune(label, format("delay %gms to %gms", a, b),
+			       {{"Delay (ms)", a}}, {{"Delay (ms)", b}});
+		retune(label, "delay past capacity", {{"Delay (ms)", 10}},
+		       {{"Delay (ms)", 200}}, 2, false, true);
+	}
+	retune("gain_1ch", "gain", {{"Gain (dB)", -20}}, {{"Gain (dB)", 6}});
+
+	/* every control of a speaker processor channel at once, band types
+	 * among them */
+	controls speaker_from = hpf, speaker_to;
+	speaker_from.emplace_back("Channel 1 Highpass Order (0 to 16)", 2);
+	speaker_from.emplace_back("Channel 1 Gain (dB)", -6);
+	speaker_from.emplace_back("Channel 1 Delay (ms)", 1);
+	for (auto &[name, v] : types)
+		speaker_to.emplace_back("Channel 1 " + name, v);
+	for (auto &[name, v] : moved)
+		speaker_to.emplace_back("Channel 1 " + name, v);
+	speaker_to.emplace_back("Channel 1 Band 1 Type", 0);
+	speaker_to.emplace_back("Channel 1 Highpass Frequency (Hz)", 80);
+	speaker_to.emplace_back("Channel 1 Highpass Order (0 to 16)", 6);
+	speaker_to.emplace_back("Channel 1 Gain (dB)", 3);
+	speaker_to.emplace_back("Channel 1 Invert Polarity", 1);
+	speaker_to.emplace_back("Channel 1 Delay (ms)", 4);
+	retune("speaker_processor_1ch", "every control", speaker_from,
+	       speaker_to, 4);
+	retune("speaker_processor_1ch", "delay past capacity", speaker_from,
+	       {{"Channel 1 Delay (ms)", 200}}, 2, false, true);
+}
+
+} /* namespace */
+
+int
+main(int argc, char **argv)
+{
+	const auto path = argc > 1 ? argv[1] : "./po-plugins.so";
+	for (int i = 2; i < argc; ++i)
+		labels.emplace_back(argv[i]);
+	auto lib = dlopen(path, RTLD_NOW);
+	if (!lib) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	descriptors = reinterpret_cast<LADSPA_Descriptor_Function>(
+	    dlsym(lib, "ladspa_descriptor"));
+	if (!descriptors) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+
+	printf("%-36s %-30s %9s %9s %9s %9s\n", "label", "settings", "dB",
+	       "degrees", "samples", "adding");
+	designs();
+	filters();
+	equalisers();
+	crossovers();
+	others();
+	live();
+	dlclose(lib);
+	return ok ? 0 : 1;
+}
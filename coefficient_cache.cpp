@@ -0,0 +1,115 @@
+#include "coefficient_cache.h"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace {
+
+constexpr size_t table_size = 4096;	/* must be power-of-two */
+constexpr size_t max_probe = 32;
+
+template<size_t N>
+struct alignas(64) entry {
+	coefficient_key key;
+	typename coefficient_cache<N>::coefficients c;
+};
+
+/*
+ * table - hash table of published entries, freed when the library unloads
+ */
+template<size_t N>
+struct table {
+	~table()
+	{
+		for (auto &s : slots)
+			delete s.load(std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<entry<N> *>, table_size> slots = {};
+};
+
+template<size_t N>
+constinit table<N> cache;
+
+/*
+ * hash - hash all parameters of a key
+ *
+ * Adding zero folds -0 into +0 so that keys which compare equal also hash
+ * equally.
+ */
+size_t
+hash(const coefficient_key &k)
+{
+	uint64_t h = static_cast<uint64_t>(k.type);
+	auto mix = [&](uint64_t v) {
+		/* see splitmix64 */
+		h ^= v + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+		h ^= h >> 31;
+	};
+	mix(std::bit_cast<uint64_t>(k.f0 + 0.0));
+	mix(std::bit_cast<uint64_t>(k.gain + 0.0));
+	mix(std::bit_cast<uint64_t>(k.Q + 0.0));
+	mix(k.order);
+	mix(k.fs);
+	return h;
+}
+
+} /* namespace */
+
+/*
+ * coefficient_cache::find - find cached coefficients for a key
+ */
+template<size_t N>
+const typename coefficient_cache<N>::coefficients *
+coefficient_cache<N>::find(const coefficient_key &k)
+{
+	const auto h = hash(k);
+	for (size_t i = 0; i < max_probe; ++i) {
+		auto e = cache<N>.slots[(h + i) % table_size].load(
+			std::memory_order_acquire);
+		if (!e)
+			return nullptr;
+		if (e->key == k)
+			return &e->c;
+	}
+	return nullptr;
+}
+
+/*
+ * coefficient_cache::insert - find or design and publish coefficients
+ *
+ * If another thread publishes the same key first its entry is used instead.
+ */
+template<size_t N>
+const typename coefficient_cache<N>::coefficients *
+coefficient_cache<N>::insert(const coefficient_key &k,
+			     const std::function<void(coefficients &)> &design)
+{
+	if (auto c = find(k))
+		return c;
+
+	auto n = new entry<N>{k, {}};
+	design(n->c);
+
+	const auto h = hash(k);
+	for (size_t i = 0; i < max_probe; ++i) {
+		auto &s = cache<N>.slots[(h + i) % table_size];
+		entry<N> *e = nullptr;
+		if (s.compare_exchange_strong(e, n, std::memory_order_acq_rel,
+					      std::memory_order_acquire))
+			return &n->c;
+		if (e->key == k) {
+			delete n;
+			return &e->c;
+		}
+	}
+
+	delete n;
+	return nullptr;
+}
+
+template class coefficient_cache<1>;
+template class coefficient_cache<8>;
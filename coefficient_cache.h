@@ -0,0 +1,54 @@
+#pragma once
+
+#include "biquad.h"
+#include <array>
+#include <cstddef>
+#include <functional>
+
+/*
+ * coefficient_key - parameters which fully determine a filter design
+ *
+ * Parameters which don't apply to a filter type should be left at zero.
+ */
+struct coefficient_key {
+	enum class filter {
+		peaking,
+		low_shelf,
+		high_shelf,
+		butterworth_lowpass,
+		butterworth_highpass,
+		linkwitz_riley_lowpass,
+		linkwitz_riley_highpass,
+	};
+
+	filter type;
+	double f0 = 0, gain = 0, Q = 0;
+	unsigned order = 0;
+	unsigned long fs = 0;
+
+	bool operator==(const coefficient_key &) const = default;
+};
+
+/*
+ * coefficient_cache - process wide cache of filter designs
+ *
+ * Many instances of a plugin are often loaded with identical settings. The
+ * cache lets them share one immutable copy of the coefficients, aligned to a
+ * cache line, rather than designing and storing their own.
+ *
+ * Entries are held in a fixed size open addressing table of atomic pointers
+ * and are never modified or removed once published, so find() is lock free
+ * and safe to call from run(). insert() allocates and must only be called
+ * from activate(). Both return nullptr if the key is not cached and can't be
+ * added, in which case callers design their own coefficients.
+ */
+template<size_t N>
+class coefficient_cache {
+public:
+	using coefficients = std::array<biquad_coefficients, N>;
+
+	static const coefficients *find(const coefficient_key &);
+	static const coefficients *
+	insert(const coefficient_key &,
+	       const std::function<void(coefficients &)> &design);
+};
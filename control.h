@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdio>
+#include <ladspa.h>
+
+/*
+ * control_port - input control port with change tracking
+ *
+ * Hosts may change control values between calls to run(), so plugins keep
+ * the port pointer and call update() to latch the current value.
+ */
+class control_port {
+public:
+	void connect(const LADSPA_Data *d)
+	{
+		port_ = d;
+	}
+
+	/*
+	 * update - latch the port value, returns true if it has changed
+	 *
+	 * Always returns true the first time a connected port is read.
+	 */
+	bool update()
+	{
+		if (!port_)
+			return false;
+		auto v = *port_;
+		if (valid_ && v == value_)
+			return false;
+		value_ = v;
+		valid_ = true;
+		return true;
+	}
+
+	operator LADSPA_Data() const
+	{
+		return value_;
+	}
+
+private:
+	const LADSPA_Data *port_ = nullptr;
+	LADSPA_Data value_ = 0;
+	bool valid_ = false;
+};
+
+/*
+ * control_warning - warning about a control value which had to be corrected
+ *
+ * Printing may block, so run() only counts the corrections with raise() and
+ * activate() and deactivate() print them with report().
+ */
+class control_warning {
+public:
+	void raise()
+	{
+		++count_;
+	}
+
+	/*
+	 * report - print 'format' if raised since the last report
+	 */
+	template<typename... Args>
+	void report(const char *format, Args... args)
+	{
+		if (!count_)
+			return;
+		if constexpr (sizeof...(args) == 0)
+			fputs(format, stderr);
+		else
+			fprintf(stderr, format, args...);
+		count_ = 0;
+	}
+
+private:
+	unsigned long count_ = 0;
+};
@@ -0,0 +1,175 @@
+#include "convolution_bank.h"
+
+#include <algorithm>
+#include <cstring>
+
+/*
+ * convolution_bank
+ */
+convolution_bank::convolution_bank(size_t channels, size_t filters,
+				   size_t length, size_t partition)
+: size_{partition}
+, count_{std::max<size_t>(1, (length + partition - 1) / partition)}
+, length_{length}
+, channels_{channels}
+, filters_{filters}
+, fft_{2 * partition}
+, set_fft_{2 * partition}
+, h_re_(filters * count_ * size_)
+, h_im_(filters * count_ * size_)
+, x_re_(channels * count_ * size_)
+, x_im_(channels * count_ * size_)
+, acc_re_(size_)
+, acc_im_(size_)
+, input_(channels * 2 * size_)
+, output_(channels * filters * 2 * size_)
+, padded_(2 * size_)
+, enabled_(filters, true)
+{ }
+
+/*
+ * convolution_bank::set
+ *
+ * As in partitioned_convolution each partition is zero padded to the
+ * transform size, and the scale of the transforms is folded into the
+ * partition spectra.
+ */
+void
+convolution_bank::set(size_t f, const float *ir)
+{
+	const auto scale = 1.0f / fft_.size();
+	for (size_t p = 0; p < count_; ++p) {
+		const auto start = std::min(p * size_, length_);
+		const auto n = std::min(size_, length_ - start);
+		std::fill(begin(padded_), end(padded_), 0.0f);
+		std::transform(ir + start, ir + start + n, begin(padded_),
+			       [scale](float v) { return v * scale; });
+		set_fft_.forward(data(padded_), spectrum(h_re_, f, p),
+				 spectrum(h_im_, f, p));
+	}
+}
+
+/*
+ * convolution_bank::enable
+ *
+ * The output of a filter which was disabled is from whenever it last ran, so
+ * is silenced for the rest of the block.
+ */
+void
+convolution_bank::enable(size_t f, bool on)
+{
+	if (on && !enabled_[f])
+		for (size_t c = 0; c < channels_; ++c)
+			std::fill_n(&output_[2 * (c * filters_ + f) * size_],
+				    2 * size_, 0.0f);
+	enabled_[f] = on;
+}
+
+/*
+ * convolution_bank::reset
+ */
+void
+convolution_bank::reset()
+{
+	std::fill(begin(x_re_), end(x_re_), 0.0f);
+	std::fill(begin(x_im_), end(x_im_), 0.0f);
+	std::fill(begin(input_), end(input_), 0.0f);
+	std::fill(begin(output_), end(output_), 0.0f);
+	fdl_pos_ = 0;
+	fill_ = 0;
+}
+
+/*
+ * convolution_bank::run
+ *
+ * Each chunk of input is copied into the current block before the matching
+ * chunk of the previous block's output is stored. Channels beyond 'channels'
+ * are convolved with silence. Outputs of disabled filters are not written.
+ */
+void
+convolution_bank::run(const float *const *input, float *const *output,
+		      size_t channels, size_t samples)
+{
+	channels = std::min(channels, channels_);
+	for (size_t i = 0; i < samples;) {
+		const auto n = std::min(samples - i, size_ - fill_);
+		for (size_t c = 0; c < channels; ++c)
+			memcpy(&input_[(2 * c + 1) * size_ + fill_],
+			       input[c] + i, n * sizeof(float));
+		for (size_t c = channels; c < channels_; ++c)
+			std::fill_n(&input_[(2 * c + 1) * size_ + fill_], n,
+				    0.0f);
+		for (size_t o = 0; o < channels * filters_; ++o)
+			if (enabled_[o % filters_])
+				memcpy(output[o] + i,
+				       &output_[(2 * o + 1) * size_ + fill_],
+				       n * sizeof(float));
+		fill_ += n;
+		i += n;
+		if (fill_ == size_)
+			process();
+	}
+}
+
+/*
+ * convolution_bank::process - convolve a complete block of input
+ */
+void
+convolution_bank::process()
+{
+	fdl_pos_ = fdl_pos_ ? fdl_pos_ - 1 : count_ - 1;
+	for (size_t c = 0; c < channels_; ++c) {
+		auto in = &input_[2 * c * size_];
+		fft_.forward(in, spectrum(x_re_, c, fdl_pos_),
+			     spectrum(x_im_, c, fdl_pos_));
+		memcpy(in, in + size_, size_ * sizeof(float));
+
+		for (size_t f = 0; f < filters_; ++f) {
+			if (!enabled_[f])
+				continue;
+			/* partition p multiplies the input spectrum from p
+			 * blocks ago */
+			std::fill(begin(acc_re_), end(acc_re_), 0.0f);
+			std::fill(begin(acc_im_), end(acc_im_), 0.0f);
+			for (size_t p = 0, x = fdl_pos_; p < count_; ++p) {
+				fft::multiply_accumulate(data(acc_re_),
+				    data(acc_im_), spectrum(x_re_, c, x),
+				    spectrum(x_im_, c, x),
+				    spectrum(h_re_, f, p),
+				    spectrum(h_im_, f, p), size_);
+				if (++x == count_)
+					x = 0;
+			}
+			fft_.inverse(data(acc_re_), data(acc_im_),
+				     &output_[2 * (c * filters_ + f) * size_]);
+		}
+	}
+	fill_ = 0;
+}
+
+/*
+ * convolution_bank::latency
+ */
+size_t
+convolution_bank::latency() const
+{
+	return size_;
+}
+
+/*
+ * convolution_bank::remaining
+ */
+size_t
+convolution_bank::remaining() const
+{
+	return size_ - fill_;
+}
+
+/*
+ * convolution_bank::spectrum - partition of a filter or input spectrum
+ */
+float *
+convolution_bank::spectrum(std::vector<float> &v, size_t i, size_t partition)
+{
+	return &v[(i * count_ + partition) * size_];
+}
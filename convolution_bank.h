@@ -0,0 +1,74 @@
+#pragma once
+
+#include "fft.h"
+#include <cstddef>
+#include <vector>
+
+/*
+ * convolution_bank - convolve several channels with each of several filters
+ *
+ * Uniformly partitioned overlap-save convolution as in
+ * partitioned_convolution, arranged so that work is shared: the input of each
+ * channel is transformed once per block for all filters, and each filter's
+ * partition spectra are used for all channels. A bank of F filters over C
+ * channels costs C forward and C * F inverse transforms per block rather
+ * than C * F of each.
+ *
+ * Filters are at most 'length' taps, start out silent and are enabled.
+ * set() replaces a filter and takes effect from the next block. It has its
+ * own transform, so another thread may set a disabled filter while run()
+ * computes the others. Disabled filters cost nothing in run() and their
+ * outputs are left alone. A filter enabled while running outputs silence
+ * until the end of the current block, after which its output is complete as
+ * the input history is shared, so switching filters without a gap means
+ * enabling the new ones remaining() samples ahead.
+ *
+ * Output is delayed by 'partition' samples. All memory is allocated by the
+ * constructor, so set(), enable(), reset() and run() are real time safe.
+ */
+class convolution_bank {
+public:
+	/* 'partition' must be a power of two, at least 2 */
+	convolution_bank(size_t channels, size_t filters, size_t length,
+			 size_t partition);
+
+	/* replace filter 'f' with 'length' taps */
+	void set(size_t f, const float *ir);
+
+	/* turn computing filter 'f' on or off */
+	void enable(size_t f, bool);
+
+	/* clear all input history */
+	void reset();
+
+	/* output[c * filters + f] is channel c through filter f, and input
+	 * and output may point to the same place */
+	void run(const float *const *input, float *const *output,
+		 size_t channels, size_t samples);
+
+	/* delay of the output in samples */
+	size_t latency() const;
+
+	/* samples until the end of the current block */
+	size_t remaining() const;
+
+private:
+	void process();
+	float *spectrum(std::vector<float> &, size_t i, size_t partition);
+
+	size_t size_;			/* partition size */
+	size_t count_;			/* partitions per filter */
+	size_t length_;
+	size_t channels_, filters_;
+	fft fft_;
+	fft set_fft_;			/* for set(), which may run alongside */
+	std::vector<float> h_re_, h_im_;	/* [filters][count_][size_] */
+	std::vector<float> x_re_, x_im_;	/* [channels][count_][size_] */
+	size_t fdl_pos_ = 0;			/* newest input spectrum */
+	std::vector<float> acc_re_, acc_im_;	/* output spectrum */
+	std::vector<float> input_;	/* [channels][2 * size_] */
+	std::vector<float> output_;	/* [channels * filters][2 * size_] */
+	std::vector<float> padded_;	/* partition of a new filter */
+	std::vector<char> enabled_;	/* [filters] */
+	size_t fill_ = 0;		/* samples in the current block */
+};
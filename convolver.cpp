@@ -0,0 +1,238 @@
+#include "denormal.h"
+#include "descriptor.h"
+#include "idle.h"
+#include "impulse_response.h"
+#include "io.h"
+#include "ladspa_ids.h"
+#include "nonuniform_convolution.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto control = 1;
+constexpr auto channels = 8;
+constexpr size_t max_length = 1 << 20;	/* in samples */
+
+struct filter {
+	LADSPA_Data *latency = nullptr;
+	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
+	std::unique_ptr<nonuniform_convolution> conv;
+	size_t tail = 0;	/* in samples */
+	idle_tracker idle;
+};
+
+/*
+ * instantiate - load the impulse response named by PO_CONVOLVER_IR
+ *
+ * Channel i is convolved with channel i modulo the number of channels in the
+ * file. If there is no usable file every channel passes audio through
+ * delayed by the latency of the convolution.
+ */
+LADSPA_Handle
+instantiate(const LADSPA_Descriptor *d, unsigned long fs)
+{
+	impulse_response ir;
+	auto path = getenv("PO_CONVOLVER_IR");
+	if (!path)
+		fprintf(stderr, "WARNING: PO_CONVOLVER_IR is not set. Passing audio through.\n");
+	else if (!read_impulse_response(path, max_length, ir))
+		fprintf(stderr, "WARNING: Passing audio through.\n");
+	else if (ir.rate != fs)
+		fprintf(stderr, "WARNING: %s is sampled at %luHz, not %luHz. Using it anyway.\n",
+			path, ir.rate, fs);
+	if (ir.channels.empty())
+		ir.channels.assign(1, {1.0f});
+
+	std::vector<std::span<const float>> h;
+	for (size_t i = 0; i < (idle_port(d) - control) / 2; ++i)
+		h.emplace_back(ir.channels[i % ir.channels.size()]);
+
+	auto p = new filter;
+	p->idle.init(d);
+	p->conv = std::make_unique<nonuniform_convolution>(h,
+	    partition_from_env());
+	p->tail = p->conv->latency();
+	for (auto &c : ir.channels)
+		p->tail = std::max(p->tail, p->conv->latency() + size(c));
+	return p;
+}
+
+void
+connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+
+	if (p->idle.connect(port, d))
+		return;
+	switch (port) {
+	case 0:
+		p->latency = d;
+		return;
+	}
+	port -= control;
+	if (port >= 2 * channels)
+		return;
+	p->io[port / 2][port % 2] = d;
+}
+
+void
+activate(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->conv->reset();
+	p->idle.reset();
+}
+
+void
+deactivate(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	if (auto n = p->conv->misses())
+		fprintf(stderr, "WARNING: Convolution tail missed %zu deadlines. Try a larger partition size.\n",
+			n);
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	const auto n = connected_channels(p->io, in, out);
+
+	if (p->latency)
+		*p->latency = p->conv->latency();
+
+	/* store silence once the impulse response has rung out, skipping runs
+	 * leaves the convolution as if it had been given silence */
+	if (p->idle.set(p->idle.quiet(data(in), n, samples, p->tail),
+			samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+	p->conv->run(data(in), data(out), n, samples, store);
+}
+
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
+}
+
+void
+cleanup(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	delete p;
+}
+
+constexpr std::array<LADSPA_PortDescriptor, control + 2 * channels> ports = {
+	LADSPA_PORT_CONTROL | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+};
+/* hosts report latency from an output control port named "latency" */
+constexpr std::array<const char *, size(ports)> port_names = {
+	"latency",
+	"Channel 1 Input",
+	"Channel 1 Output",
+	"Channel 2 Input",
+	"Channel 2 Output",
+	"Channel 3 Input",
+	"Channel 3 Output",
+	"Channel 4 Input",
+	"Channel 4 Output",
+	"Channel 5 Input",
+	"Channel 5 Output",
+	"Channel 6 Input",
+	"Channel 6 Output",
+	"Channel 7 Input",
+	"Channel 7 Output",
+	"Channel 8 Input",
+	"Channel 8 Output",
+};
+constexpr std::array<LADSPA_PortRangeHint, size(ports)> port_hints = {};
+
+/*
+ * register plugin instances
+ */
+struct init {
+	init()
+	{
+		/* not hard real time capable, run() waits for the tail
+		 * worker when it is late and the impulse response, and so
+		 * whether there is a worker at all, is only known once
+		 * instantiated */
+		LADSPA_Descriptor d = {
+			.UniqueID = 0,
+			.Label = nullptr,
+			.Properties = 0,
+			.Name = nullptr,
+			.Maker = "Patrick Oppenlander <patrick.oppenlander@gmail.com>",
+			.Copyright = "Patrick Oppenlander, 2021",
+			.PortCount = 0,
+			.PortDescriptors = data(ports),
+			.PortNames = data(port_names),
+			.PortRangeHints = data(port_hints),
+			.ImplementationData = nullptr,
+			.instantiate = instantiate,
+			.connect_port = connect_port,
+			.activate = activate,
+			.run = run,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
+			.deactivate = deactivate,
+			.cleanup = cleanup,
+		};
+
+		for (int i = 0; i < channels; ++i) {
+			d.UniqueID = ladspa_ids::convolver + i;
+			d.PortCount = control + (i + 1) * 2;
+			register_plugin({d,
+			    "convolver_" + std::to_string(i + 1) + "ch",
+			    "Convolver (" + std::to_string(i + 1) + " Channel)"});
+		}
+	}
+} init;
+
+} /* namespace */
@@ -0,0 +1,526 @@
+#include "biquad.h"
+#include "control.h"
+#include "denormal.h"
+#include "descriptor.h"
+#include "idle.h"
+#include "ladspa_ids.h"
+#include "smooth.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace {
+
+constexpr auto channels = 8;
+
+/* samples of input copied to scratch at a time */
+constexpr auto block = 256;
+
+/*
+ * filter - Linkwitz Riley crossover with N bands
+ *
+ * The bands are split off a tree of complementary lowpass & highpass pairs.
+ * Split k takes band k from its input with a lowpass and passes the rest on
+ * to split k + 1 with a highpass. Each band below the last split is followed
+ * by the allpass sum of every split above it, so all bands carry the same
+ * phase and sum to an allpass.
+ *
+ * The input of every channel is read once per block into scratch, and each
+ * pair of sections is then run over the same cache resident data. This also
+ * makes it safe for hosts to share an output buffer with any input.
+ */
+template<size_t N>
+struct filter {
+	static constexpr auto splits = N - 1;
+	static constexpr auto control = splits + 1;
+
+	std::array<control_port, splits> f;
+	control_port order;
+	control_warning order_invalid;
+	std::array<ramp, splits> log_f;
+	unsigned filter_order = 4;
+	unsigned sections = 2;
+	unsigned allpass_sections = 1;
+	std::array<LADSPA_Data *, channels> in = {};
+	std::array<std::array<LADSPA_Data *, N>, channels> out = {};
+	LADSPA_Data adding_gain = 1;
+	unsigned long fs = 0;
+
+	/* lowpass sections of split k followed by the allpass of each split
+	 * above it, and the highpass sections of split k */
+	std::array<std::array<biquad_coefficients, 8>, splits> low_c;
+	std::array<std::array<biquad_coefficients, 4>, splits> high_c;
+	std::array<biquad_cascade<8>, splits> low;
+	std::array<biquad_cascade<4>, splits> high;
+	idle_tracker idle;
+
+	/* input of the current split and input of the next split */
+	alignas(32) std::array<std::array<float, block>, channels> x, rest;
+};
+
+template<size_t N>
+LADSPA_Handle
+instantiate(const LADSPA_Descriptor *d, unsigned long fs)
+{
+	auto p = new filter<N>;
+	p->fs = fs;
+	p->idle.init(d);
+	for (auto &c : p->low) {
+		c.set_kernel(biquad_kernel_from_env());
+		c.set_precision(biquad_precision_from_env());
+	}
+	for (auto &c : p->high) {
+		c.set_kernel(biquad_kernel_from_env());
+		c.set_precision(biquad_precision_from_env());
+	}
+	return p;
+}
+
+template<size_t N>
+void
+connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+
+	if (p->idle.connect(port, d))
+		return;
+	if (port < filter<N>::splits)
+		return p->f[port].connect(d);
+	if (port == filter<N>::splits)
+		return p->order.connect(d);
+	port -= filter<N>::control;
+	if (port >= (N + 1) * channels)
+		return;
+	auto ch = port / (N + 1);
+	auto i = port % (N + 1);
+	if (i == 0)
+		p->in[ch] = d;
+	else
+		p->out[ch][i - 1] = d;
+}
+
+/*
+ * settled - true if no crossover frequency is ramping
+ */
+template<size_t N>
+bool
+settled(const filter<N> *p)
+{
+	return std::all_of(begin(p->log_f), end(p->log_f),
+			   [](auto &r) { return r.settled(); });
+}
+
+/*
+ * design - compute coefficients for the current ramp values
+ */
+template<size_t N>
+void
+design(filter<N> *p, biquad_design d = biquad_design::exact)
+{
+	constexpr auto splits = filter<N>::splits;
+	const auto order = p->filter_order;
+
+	std::array<std::array<biquad_coefficients, 2>, splits> ap;
+	for (size_t k = 0; k < splits; ++k) {
+		auto f0 = std::exp(p->log_f[k].value());
+		linkwitz_riley_lowpass(data(p->low_c[k]), order, f0, p->fs, d);
+		linkwitz_riley_highpass(data(p->high_c[k]), order, f0, p->fs,
+					d);
+		/* bands built from odd order Butterworth halves only sum flat
+		 * with alternate polarity, which also makes the sum an
+		 * allpass */
+		if (order / 2 % 2)
+			p->high_c[k][0].invert();
+		butterworth_allpass(data(ap[k]), order / 2, f0, p->fs, d);
+	}
+
+	/* compensate each band for the phase of the splits above it */
+	for (size_t k = 0; k < splits; ++k)
+		for (size_t j = k + 1; j < splits; ++j)
+			std::copy_n(begin(ap[j]), p->allpass_sections,
+				    begin(p->low_c[k]) + p->sections +
+				    (j - k - 1) * p->allpass_sections);
+}
+
+/*
+ * resize - change the number of sections of each filter and of each allpass
+ *
+ * Sections are inserted after the others, where their input has already
+ * been filtered, and erased from the front, so that the output of each
+ * filter and of each allpass carries on from its own history rather than
+ * from the state of sections which were not running. Both numbers grow or
+ * shrink together with the order.
+ *
+ * Highpasses are inverted when half the order is odd, so when that changes
+ * the state after the first highpass section of every split, and all state
+ * of the splits fed an inverted signal, is inverted too.
+ */
+template<size_t N>
+void
+resize(filter<N> *p, unsigned sections, unsigned allpass_sections)
+{
+	constexpr auto splits = filter<N>::splits;
+	const auto s = p->sections, a = p->allpass_sections;
+	const auto flip = s % 2 != sections % 2;
+	for (size_t ch = 0; ch < channels; ++ch) {
+		for (size_t k = 0; k < splits; ++k) {
+			auto &low = p->low[k];
+			if (flip) {
+				if (k % 2) {
+					low.invert(0, ch);
+					p->high[k].invert(0, ch);
+				}
+				p->high[k].invert(1, ch);
+			}
+			/* last allpass first so earlier ones stay in place */
+			for (auto g = splits - k - 1; g-- > 0;) {
+				const auto first = s + g * a;
+				for (auto n = a; n < allpass_sections; ++n)
+					low.insert(first + a, ch);
+				for (auto n = allpass_sections; n < a; ++n)
+					low.erase(first, ch);
+			}
+			for (auto n = s; n < sections; ++n) {
+				low.insert(s, ch);
+				p->high[k].insert(s, ch);
+			}
+			for (auto n = sections; n < s; ++n) {
+				low.erase(0, ch);
+				p->high[k].erase(0, ch);
+			}
+		}
+	}
+	p->sections = sections;
+	p->allpass_sections = allpass_sections;
+}
+
+/*
+ * update - retarget frequency ramps or change order if controls changed
+ */
+template<size_t N>
+void
+update(filter<N> *p)
+{
+	auto changed = false;
+	for (size_t k = 0; k < filter<N>::splits; ++k) {
+		if (!p->f[k].update())
+			continue;
+		/* frequency ramps in octaves rather than hertz */
+		p->log_f[k].set(std::log(std::max<double>(p->f[k], 1)),
+				p->fs * ramp_time);
+		changed = true;
+	}
+	if (p->order.update()) {
+		/* convert only values in range, NaN compares false */
+		const LADSPA_Data value = p->order;
+		unsigned order = value >= 0 && value <= 8 ? value : 0;
+		if (order < 2 || order > 8 || order % 2) {
+			p->order_invalid.raise();
+			order = 4;
+		}
+		p->filter_order = order;
+		/* a section per pole pair, and the allpass of each split has
+		 * the phase of a Butterworth filter of half the order */
+		resize(p, order / 2, (order / 2 + 1) / 2);
+		changed = true;
+	}
+
+	/* ramping frequencies are designed block by block in run() */
+	if (changed && settled(p))
+		design(p);
+}
+
+/*
+ * report - print warnings about controls corrected since the last report
+ */
+template<size_t N>
+void
+report(filter<N> *p)
+{
+	p->order_invalid.report("WARNING: Linkwitz Riley crossover must be 2nd, 4th, 6th or 8th order. Defaulting to 4th order.\n");
+}
+
+template<size_t N>
+void
+activate(LADSPA_Handle h)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	update(p);
+	report(p);
+	p->idle.reset();
+	for (auto &r : p->log_f)
+		r.finish();
+	design(p);
+}
+
+template<size_t N>
+void
+deactivate(LADSPA_Handle h)
+{
+	report(reinterpret_cast<filter<N> *>(h));
+}
+
+/*
+ * quiet - true if every split has decayed to silence
+ */
+template<size_t N>
+bool
+quiet(const filter<N> *p)
+{
+	constexpr auto splits = filter<N>::splits;
+
+	for (size_t k = 0; k < splits; ++k) {
+		const auto low = p->sections +
+				 (splits - k - 1) * p->allpass_sections;
+		if (!p->low[k].quiet(low, silence) ||
+		    !p->high[k].quiet(p->sections, silence))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<size_t N, typename S>
+void
+process(filter<N> *p, unsigned long samples, S store)
+{
+	constexpr auto splits = filter<N>::splits;
+
+	denormals_off guard;
+	update(p);
+
+	/* stop on the first channel which is not fully connected */
+	size_t n = 0;
+	for (; n < channels; ++n)
+		if (!p->in[n] || std::count(begin(p->out[n]), end(p->out[n]),
+					    nullptr))
+			break;
+
+	/* store silence while silence goes in and the filters have decayed */
+	const auto idle = p->idle.quiet(data(p->in), n, samples) &&
+			  settled(p) && quiet(p);
+	if (p->idle.set(idle, samples)) {
+		for (size_t c = 0; c < n; ++c)
+			for (auto out : p->out[c])
+				store_silence(p->in[c], out, samples, store);
+		return;
+	}
+
+	std::array<const float *, channels> x, rest;
+	std::array<float *, channels> xw, restw, band;
+	for (size_t c = 0; c < n; ++c) {
+		x[c] = xw[c] = data(p->x[c]);
+		rest[c] = restw[c] = data(p->rest[c]);
+	}
+
+	for (unsigned long i = 0, len; i < samples; i += len) {
+		len = std::min<unsigned long>(samples - i, block);
+		if (!settled(p)) {
+			len = std::min<unsigned long>(len, ramp_block);
+			for (auto &r : p->log_f)
+				r.advance(len);
+			/* approximate while moving, exact once settled */
+			design(p, settled(p) ? biquad_design::exact
+					     : biquad_design::fast);
+		}
+
+		/* all inputs are copied before any output is written */
+		for (size_t c = 0; c < n; ++c)
+			memcpy(p->x[c].data(), p->in[c] + i, len * sizeof(float));
+
+		for (size_t k = 0; k < splits; ++k) {
+			auto &src = k % 2 ? rest : x;
+			auto &dst = k % 2 ? xw : restw;
+			for (size_t c = 0; c < n; ++c)
+				band[c] = p->out[c][k] + i;
+			p->low[k].run(p->low_c[k], p->sections +
+				      (splits - k - 1) * p->allpass_sections,
+				      data(src), data(band), n, len, store);
+			if (k + 1 < splits) {
+				p->high[k].run(p->high_c[k], p->sections,
+					       data(src), data(dst), n, len);
+				continue;
+			}
+			for (size_t c = 0; c < n; ++c)
+				band[c] = p->out[c][N - 1] + i;
+			p->high[k].run(p->high_c[k], p->sections, data(src),
+				       data(band), n, len, store);
+		}
+	}
+}
+
+template<size_t N>
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	process(p, samples, replace{});
+}
+
+template<size_t N>
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+template<size_t N>
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	p->adding_gain = gain;
+}
+
+template<size_t N>
+void
+cleanup(LADSPA_Handle h)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	delete p;
+}
+
+/*
+ * band_names - output names for a crossover with N bands
+ */
+template<size_t N>
+constexpr std::array<const char *, N> band_names();
+
+template<>
+constexpr std::array<const char *, 2> band_names<2>()
+{
+	return {"Low", "High"};
+}
+
+template<>
+constexpr std::array<const char *, 3> band_names<3>()
+{
+	return {"Low", "Mid", "High"};
+}
+
+template<>
+constexpr std::array<const char *, 4> band_names<4>()
+{
+	return {"Low", "Low Mid", "High Mid", "High"};
+}
+
+/*
+ * register_crossover - register instances of a crossover with N bands
+ *
+ * Port layout is the control ports followed by the input and the band
+ * outputs of each channel in turn.
+ */
+template<size_t N>
+void
+register_crossover(int id)
+{
+	constexpr auto splits = filter<N>::splits;
+	constexpr auto control = filter<N>::control;
+	constexpr auto count = control + (N + 1) * channels;
+
+	/* descriptors keep pointers to these */
+	static std::array<LADSPA_PortDescriptor, count> ports;
+	static std::array<std::string, count> names;
+	static std::array<const char *, count> port_names;
+	static std::array<LADSPA_PortRangeHint, count> port_hints;
+
+	for (size_t k = 0; k < splits; ++k) {
+		ports[k] = LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT;
+		names[k] = splits > 1
+		    ? "Crossover Frequency " + std::to_string(k + 1) + " (Hz)"
+		    : "Crossover Frequency (Hz)";
+		/* default to splits spread evenly in octaves */
+		port_hints[k] = {
+			.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+					  LADSPA_HINT_BOUNDED_ABOVE |
+					  LADSPA_HINT_SAMPLE_RATE |
+					  LADSPA_HINT_LOGARITHMIC,
+			.LowerBound = 0.0005,
+			.UpperBound = 0.45,
+		};
+		switch (splits > 1 ? k * 2 / (splits - 1) : 1) {
+		case 0:
+			port_hints[k].HintDescriptor |= LADSPA_HINT_DEFAULT_LOW;
+			break;
+		case 1:
+			port_hints[k].HintDescriptor |= LADSPA_HINT_DEFAULT_MIDDLE;
+			break;
+		default:
+			port_hints[k].HintDescriptor |= LADSPA_HINT_DEFAULT_HIGH;
+			break;
+		}
+	}
+	ports[splits] = LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT;
+	names[splits] = "Order";
+	port_hints[splits] = {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_LOGARITHMIC |
+				  LADSPA_HINT_DEFAULT_MIDDLE,
+		.LowerBound = 2,
+		.UpperBound = 8,
+	};
+	for (size_t c = 0; c < channels; ++c) {
+		auto ch = "Channel " + std::to_string(c + 1);
+		auto p = control + c * (N + 1);
+		ports[p] = LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT;
+		names[p] = ch + " Input";
+		for (size_t b = 0; b < N; ++b) {
+			ports[p + b + 1] = LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT;
+			names[p + b + 1] = ch + " " + band_names<N>()[b] + " Output";
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+		port_names[i] = names[i].c_str();
+
+	LADSPA_Descriptor d = {
+		.UniqueID = 0,
+		.Label = nullptr,
+		.Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+		.Name = nullptr,
+		.Maker = "Patrick Oppenlander <patrick.oppenlander@gmail.com>",
+		.Copyright = "Patrick Oppenlander, 2021",
+		.PortCount = 0,
+		.PortDescriptors = data(ports),
+		.PortNames = data(port_names),
+		.PortRangeHints = data(port_hints),
+		.ImplementationData = nullptr,
+		.instantiate = instantiate<N>,
+		.connect_port = connect_port<N>,
+		.activate = activate<N>,
+		.run = run<N>,
+		.run_adding = run_adding<N>,
+		.set_run_adding_gain = set_run_adding_gain<N>,
+		.deactivate = deactivate<N>,
+		.cleanup = cleanup<N>,
+	};
+
+	auto ways = std::to_string(N) + "way";
+	for (int i = 0; i < channels; ++i) {
+		d.UniqueID = id + i;
+		d.PortCount = control + (i + 1) * (N + 1);
+		register_plugin({d,
+		    "crossover_" + ways + "_" + std::to_string(i + 1) + "ch",
+		    "Linkwitz Riley Crossover (" + std::to_string(N) +
+		    " Way, " + std::to_string(i + 1) + " Channel)"});
+	}
+}
+
+/*
+ * register plugin instances
+ */
+struct init {
+	init()
+	{
+		register_crossover<2>(ladspa_ids::crossover_2way);
+		register_crossover<3>(ladspa_ids::crossover_3way);
+		register_crossover<4>(ladspa_ids::crossover_4way);
+	}
+} init;
+
+} /* namespace */
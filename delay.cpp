@@ -1,21 +1,35 @@
-#include "biquad.h"
+#include "control.h"
+#include "delay_line.h"
+#include "denormal.h"
 #include "descriptor.h"
+#include "idle.h"
+#include "io.h"
 #include "ladspa_ids.h"
+#include "smooth.h"
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <vector>
 
 namespace {
 
 constexpr auto control = 1;
 constexpr auto channels = 8;
-constexpr auto max_delay = 1024;	/* in samples, must be power-of-two */
+constexpr auto max_delay_ms = 5000;
 
 struct filter {
-	unsigned long delay = 0;	/* in samples */
-	unsigned long pos = 0;
+	control_port delay_ms;
+	control_warning delay_high, uncommitted;
+	unsigned long wanted = 1;	/* in samples, as set by the control */
+	unsigned long delay = 1;	/* in samples */
+	unsigned long old_delay = 1;	/* in samples, while fading */
+	ramp fade;			/* from old_delay to delay */
 	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
-	std::array<std::array<LADSPA_Data, max_delay>, channels> data = {};
+	LADSPA_Data adding_gain = 1;
+	std::vector<delay_line> lines;
+	unsigned long max_delay = 1;	/* in samples */
 	unsigned long fs = 0;
+	idle_tracker idle;
 };
 
 LADSPA_Handle
@@ -23,6 +37,12 @@ instantiate(const LADSPA_Descriptor *d, unsigned long fs)
 {
 	auto p = new filter;
 	p->fs = fs;
+	p->idle.init(d);
+	p->max_delay = std::max<unsigned long>(1, max_delay_ms / 1000.0 * fs);
+	const auto n = (idle_port(d) - control) / 2;
+	p->lines.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+		p->lines.emplace_back(p->max_delay);
 	return p;
 }
 
@@ -31,19 +51,11 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 {
 	filter *p = reinterpret_cast<filter *>(h);
 
+	if (p->idle.connect(port, d))
+		return;
 	switch (port) {
 	case 0:
-		p->delay = std::round(*d / 1000.0 * p->fs);
-		if (p->delay == 0) {
-			fprintf(stderr, "WARNING: Minimum delay is %.2fms at %luHz. Clamping.\n",
-				1000.0 / p->fs, p->fs);
-			p->delay = 1;
-		}
-		if (p->delay >= max_delay) {
-			fprintf(stderr, "WARNING: Maximum delay is %.2fms at %luHz. Clamping.\n",
-			        (max_delay - 1.0) / p->fs, p->fs);
-			p->delay = max_delay - 1;
-		}
+		p->delay_ms.connect(d);
 		return;
 	}
 	port -= control;
@@ -52,25 +64,166 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 	p->io[port / 2][port % 2] = d;
 }
 
+/*
+ * latch - recompute the wanted delay, returns true if the control changed
+ */
+bool
+latch(filter *p)
+{
+	if (!p->delay_ms.update())
+		return false;
+
+	/* clamp before converting, negative values and NaN are no delay */
+	double samples = std::round(p->delay_ms / 1000.0 * p->fs);
+	if (samples > p->max_delay) {
+		p->delay_high.raise();
+		samples = p->max_delay;
+	}
+	if (std::isnan(samples) || samples < 0)
+		samples = 0;
+	p->wanted = samples;
+	return true;
+}
+
+/*
+ * retarget - move to the wanted delay as far as the lines can hold it
+ */
 void
-run(LADSPA_Handle h, unsigned long samples)
+retarget(filter *p)
+{
+	auto delay = p->wanted;
+	for (auto &line : p->lines)
+		delay = std::min<unsigned long>(delay, line.capacity());
+	if (delay == p->delay)
+		return;
+
+	/* first setting, nothing to fade from */
+	if (p->fade.target() != 1) {
+		p->delay = delay;
+		p->fade.jump(1);
+		return;
+	}
+
+	/* crossfade to the new read position from whichever one dominates
+	 * the output right now */
+	if (p->fade.value() >= 0.5)
+		p->old_delay = p->delay;
+	p->delay = delay;
+	p->fade.jump(0);
+	p->fade.set(1, p->fs * ramp_time);
+}
+
+/*
+ * update - retarget the delay if the control has changed
+ *
+ * Committing memory may block, so only activate() grows the lines. Longer
+ * delays set while running are limited to what the lines can hold until the
+ * plugin is activated again.
+ */
+void
+update(filter *p)
+{
+	if (!latch(p))
+		return;
+	retarget(p);
+	if (p->delay < p->wanted)
+		p->uncommitted.raise();
+}
+
+/*
+ * report - print warnings about controls corrected since the last report
+ */
+void
+report(filter *p)
+{
+	p->delay_high.report("WARNING: Maximum delay is %.2fms at %luHz. Clamping.\n",
+			     p->max_delay * 1000.0 / p->fs, p->fs);
+	p->uncommitted.report("WARNING: Delay increased while running. Limiting it until the plugin is activated again.\n");
+}
+
+void
+activate(LADSPA_Handle h)
 {
 	filter *p = reinterpret_cast<filter *>(h);
-	for (auto i = 0; i < channels; ++i) {
-		auto in = p->io[i][0];
-		auto out = p->io[i][1];
-		/* stop on first unconnected port */
-		if (!in || !out)
-			break;
-		/* careful, input and output can overlap */
-		/* REVISIT: this could probably be a bit more optimal.. */
-		auto &data = p->data[i];
-		for (unsigned long j = 0; j < samples; ++j) {
-			data[(p->pos + j) % max_delay] = in[j];
-			out[j] = data[(p->pos + j - p->delay) % max_delay];
-		}
+	latch(p);
+	for (auto &line : p->lines) {
+		if (line.resize(p->wanted))
+			continue;
+		fprintf(stderr, "WARNING: Out of memory for %.2fms delay. Clamping.\n",
+			p->wanted * 1000.0 / p->fs);
+		break;
+	}
+	retarget(p);
+	report(p);
+	p->idle.reset();
+	p->fade.jump(1);
+}
+
+void
+deactivate(LADSPA_Handle h)
+{
+	report(reinterpret_cast<filter *>(h));
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
+
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence once everything in the lines is silence, and catch
+	 * them up with the silence skipped when the input returns */
+	const auto idle = p->idle.quiet(data(in), n, samples, p->delay) &&
+			  p->fade.settled();
+	if (p->idle.set(idle, samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+	if (auto skipped = p->idle.resume())
+		for (size_t c = 0; c < n; ++c)
+			p->lines[c].skip(skipped);
+
+	/* crossfade sample by sample until the fade settles */
+	const auto len = std::min<unsigned long>(samples, p->fade.remaining());
+	const LADSPA_Data t0 = p->fade.value();
+	const LADSPA_Data step = p->fade.step();
+	for (size_t c = 0; c < n; ++c) {
+		auto &line = p->lines[c];
+		line.crossfade(in[c], out[c], p->old_delay, p->delay, t0, step,
+			       len, store);
+		line.run(in[c] + len, out[c] + len, p->delay, samples - len,
+			 store);
 	}
-	p->pos += samples;
+	p->fade.advance(samples);
+}
+
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
 }
 
 void
@@ -121,10 +274,9 @@ constexpr std::array<const char *, size(ports)> port_names = {
 constexpr std::array<LADSPA_PortRangeHint, size(ports)> port_hints = { { {
 		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
 				  LADSPA_HINT_BOUNDED_ABOVE |
-				  LADSPA_HINT_SAMPLE_RATE |
 				  LADSPA_HINT_DEFAULT_1,
 		.LowerBound = 0,
-		.UpperBound = 1.0 / max_delay,
+		.UpperBound = max_delay_ms,
 	}
 } };
 
@@ -148,11 +300,11 @@ struct init {
 			.ImplementationData = nullptr,
 			.instantiate = instantiate,
 			.connect_port = connect_port,
-			.activate = nullptr,
+			.activate = activate,
 			.run = run,
-			.run_adding = nullptr,
-			.set_run_adding_gain = nullptr,
-			.deactivate = nullptr,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
+			.deactivate = deactivate,
 			.cleanup = cleanup,
 		};
 
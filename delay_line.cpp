@@ -0,0 +1,345 @@
+#include "delay_line.h"
+
+#include "simd.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * The ring holds at least 'chunk' samples beyond the maximum delay so that a
+ * chunk of input can always be written before the matching output is read
+ * without overwriting history which is still needed. This makes in place
+ * processing safe.
+ */
+namespace {
+
+constexpr size_t chunk = 256;
+
+/*
+ * interpolate - four tap interpolation of contiguous samples
+ *
+ * r[j] is the newest sample for output j, older samples are before it.
+ */
+template<typename S>
+simd_clones void
+interpolate(const float *r, float *output, const std::array<float, 4> &h,
+	    size_t samples, S store)
+{
+	const auto h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3];
+	for (size_t j = 0; j < samples; ++j)
+		store(output[j], h0 * r[j] + h1 * r[j - 1] + h2 * r[j - 2] +
+				 h3 * r[j - 3]);
+}
+
+}
+
+/*
+ * fractional_delay
+ */
+fractional_delay::fractional_delay(double delay)
+{
+	/* interpolate at d in [1, 2) from taps 0..3 */
+	const auto w = static_cast<size_t>(std::max(delay, 1.0));
+	const auto d = delay - w + 1;
+	whole = w - 1;
+	h = {
+		static_cast<float>(-(d - 1) * (d - 2) * (d - 3) / 6),
+		static_cast<float>(d * (d - 2) * (d - 3) / 2),
+		static_cast<float>(-d * (d - 1) * (d - 3) / 2),
+		static_cast<float>(d * (d - 1) * (d - 2) / 6),
+	};
+}
+
+/*
+ * delay_line
+ */
+delay_line::delay_line(size_t max_delay)
+: reserved_{std::bit_ceil(max_delay + chunk)}
+{
+	auto p = mmap(nullptr, reserved_ * sizeof(float), PROT_NONE,
+		      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		throw std::bad_alloc();
+	ring_ = static_cast<float *>(p);
+	if (!resize(1)) {
+		munmap(ring_, reserved_ * sizeof(float));
+		throw std::bad_alloc();
+	}
+}
+
+delay_line::delay_line(delay_line &&o)
+: ring_{o.ring_}, reserved_{o.reserved_}, size_{o.size_}, pos_{o.pos_}
+{
+	o.ring_ = nullptr;
+}
+
+delay_line::~delay_line()
+{
+	if (ring_)
+		munmap(ring_, reserved_ * sizeof(float));
+}
+
+/*
+ * delay_line::resize
+ *
+ * The ring grows to a larger power-of-two. History which wrapped around the
+ * end of the old ring is moved to the end of the new one so that every
+ * sample keeps its distance from the write position, and the gap between
+ * them reads as silence.
+ */
+bool
+delay_line::resize(size_t delay)
+{
+	const auto size = std::bit_ceil(delay + chunk);
+	if (size <= size_)
+		return true;
+	if (size > reserved_)
+		return false;
+
+	if (mprotect(ring_, size * sizeof(float), PROT_READ | PROT_WRITE))
+		return false;
+
+	/* fault the new pages in now rather than in run() */
+	const size_t page = sysconf(_SC_PAGESIZE) / sizeof(float);
+	for (size_t i = size_; i < size; i += page)
+		*static_cast<volatile float *>(ring_ + i) = 0;
+
+	if (size_) {
+		memcpy(ring_ + size - (size_ - pos_), ring_ + pos_,
+		       (size_ - pos_) * sizeof(float));
+		memset(ring_ + pos_, 0, (size_ - pos_) * sizeof(float));
+	}
+	size_ = size;
+	return true;
+}
+
+/*
+ * delay_line::write - append samples to the ring
+ */
+void
+delay_line::write(const float *input, size_t samples)
+{
+	const auto n = std::min(samples, size_ - pos_);
+	memcpy(ring_ + pos_, input, n * sizeof(float));
+	memcpy(ring_, input + n, (samples - n) * sizeof(float));
+	pos_ = (pos_ + samples) & (size_ - 1);
+}
+
+/*
+ * delay_line::read - read samples written 'delay' samples before the last
+ * write
+ */
+template<typename S>
+void
+delay_line::read(float *output, size_t delay, size_t samples, S store) const
+{
+	const auto start = (pos_ - samples - delay) & (size_ - 1);
+	const auto n = std::min(samples, size_ - start);
+	store.block(output, ring_ + start, n);
+	store.block(output + n, ring_, samples - n);
+}
+
+/*
+ * delay_line::read - interpolated read of samples written before the last
+ * write
+ *
+ * Runs of output whose taps are contiguous in the ring are interpolated
+ * together, only the three outputs whose taps wrap around the start of the
+ * ring are worked out one at a time.
+ */
+template<typename S>
+void
+delay_line::read(float *output, const fractional_delay &d, size_t samples,
+		 S store) const
+{
+	const auto start = pos_ - samples - d.whole;
+	for (size_t j = 0, n; j < samples; j += n) {
+		const auto s = (start + j) & (size_ - 1);
+		if (s < 3) {
+			store(output[j], tap(s, d));
+			n = 1;
+			continue;
+		}
+		n = std::min(samples - j, size_ - s);
+		interpolate(ring_ + s, output + j, d.h, n, store);
+	}
+}
+
+/*
+ * delay_line::tap - interpolate one sample with the newest tap at 'start'
+ */
+float
+delay_line::tap(size_t start, const fractional_delay &d) const
+{
+	const auto mask = size_ - 1;
+	return d.h[0] * ring_[start & mask] +
+	       d.h[1] * ring_[(start - 1) & mask] +
+	       d.h[2] * ring_[(start - 2) & mask] +
+	       d.h[3] * ring_[(start - 3) & mask];
+}
+
+/*
+ * delay_line::run
+ */
+template<typename S>
+void
+delay_line::run(const float *input, float *output, size_t delay,
+		size_t samples, S store)
+{
+	/* no delay, keep feeding the ring so that its history is current when
+	 * the delay changes, then the input is the output */
+	if (!delay) {
+		const auto keep = std::min(samples, size_);
+		pos_ = (pos_ + samples - keep) & (size_ - 1);
+		write(input + samples - keep, keep);
+		store.block(output, input, samples);
+		return;
+	}
+
+	/* careful, input and output arrays can point to the same place */
+	if (input == output) {
+		for (size_t i = 0, n; i < samples; i += n) {
+			n = std::min(chunk, samples - i);
+			write(input + i, n);
+			read(output + i, delay, n, store);
+		}
+		return;
+	}
+
+	/* separate buffers: history comes from the ring, the rest of the
+	 * output straight from the input, and only the input samples which
+	 * fit in the ring are kept */
+	const auto h = std::min(delay, samples);
+	const auto start = (pos_ - delay) & (size_ - 1);
+	const auto n = std::min(h, size_ - start);
+	store.block(output, ring_ + start, n);
+	store.block(output + n, ring_, h - n);
+	store.block(output + h, input, samples - h);
+
+	const auto keep = std::min(samples, size_);
+	pos_ = (pos_ + samples - keep) & (size_ - 1);
+	write(input + samples - keep, keep);
+}
+
+/*
+ * delay_line::crossfade
+ */
+template<typename S>
+void
+delay_line::crossfade(const float *input, float *output, size_t old_delay,
+		      size_t delay, float t0, float step, size_t samples,
+		      S store)
+{
+	for (size_t i = 0, n; i < samples; i += n) {
+		n = std::min(chunk, samples - i);
+		write(input + i, n);
+		const auto mask = size_ - 1;
+		const auto a = (pos_ - n - old_delay) & mask;
+		const auto b = (pos_ - n - delay) & mask;
+		for (size_t j = 0; j < n; ++j) {
+			auto x = ring_[(a + j) & mask];
+			auto y = ring_[(b + j) & mask];
+			store(output[i + j],
+			      x + (y - x) * (t0 + step * (i + j + 1)));
+		}
+	}
+}
+
+/*
+ * delay_line::run
+ */
+template<typename S>
+void
+delay_line::run(const float *input, float *output, const fractional_delay &d,
+		size_t samples, S store)
+{
+	for (size_t i = 0, n; i < samples; i += n) {
+		n = std::min(chunk, samples - i);
+		write(input + i, n);
+		read(output + i, d, n, store);
+	}
+}
+
+/*
+ * delay_line::crossfade
+ */
+template<typename S>
+void
+delay_line::crossfade(const float *input, float *output,
+		      const fractional_delay &old_delay,
+		      const fractional_delay &delay, float t0, float step,
+		      size_t samples, S store)
+{
+	for (size_t i = 0, n; i < samples; i += n) {
+		n = std::min(chunk, samples - i);
+		write(input + i, n);
+		const auto a = pos_ - n - old_delay.whole;
+		const auto b = pos_ - n - delay.whole;
+		for (size_t j = 0; j < n; ++j) {
+			auto x = tap(a + j, old_delay);
+			auto y = tap(b + j, delay);
+			store(output[i + j],
+			      x + (y - x) * (t0 + step * (i + j + 1)));
+		}
+	}
+}
+
+/*
+ * delay_line::clear
+ */
+void
+delay_line::clear()
+{
+	std::fill_n(ring_, size_, 0.0f);
+}
+
+/*
+ * delay_line::skip
+ *
+ * Only the most recent size_ samples are ever read, so longer silences just
+ * clear the whole ring.
+ */
+void
+delay_line::skip(size_t samples)
+{
+	if (samples >= size_) {
+		clear();
+		return;
+	}
+	const auto n = std::min(samples, size_ - pos_);
+	std::fill_n(ring_ + pos_, n, 0.0f);
+	std::fill_n(ring_, samples - n, 0.0f);
+	pos_ = (pos_ + samples) & (size_ - 1);
+}
+
+/*
+ * delay_line::capacity
+ */
+size_t
+delay_line::capacity() const
+{
+	return size_ - chunk;
+}
+
+template void delay_line::run(const float *, float *, size_t, size_t, replace);
+template void delay_line::run(const float *, float *, size_t, size_t,
+			      accumulate);
+template void delay_line::crossfade(const float *, float *, size_t, size_t,
+				    float, float, size_t, replace);
+template void delay_line::crossfade(const float *, float *, size_t, size_t,
+				    float, float, size_t, accumulate);
+template void delay_line::run(const float *, float *,
+			      const fractional_delay &, size_t, replace);
+template void delay_line::run(const float *, float *,
+			      const fractional_delay &, size_t, accumulate);
+template void delay_line::crossfade(const float *, float *,
+				    const fractional_delay &,
+				    const fractional_delay &, float, float,
+				    size_t, replace);
+template void delay_line::crossfade(const float *, float *,
+				    const fractional_delay &,
+				    const fractional_delay &, float, float,
+				    size_t, accumulate);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "store.h"
+#include <array>
+#include <cstddef>
+
+/*
+ * fractional_delay - delay split into whole samples and an interpolator
+ *
+ * The output is interpolated from the four samples delayed by whole to
+ * whole + 3 with a third order Lagrange interpolator, which keeps the
+ * interpolation point between the middle two taps. Whole sample delays give
+ * exactly { 0, 1, 0, 0 }.
+ */
+struct fractional_delay {
+	explicit fractional_delay(double delay = 1);
+
+	size_t whole;
+	std::array<float, 4> h;
+};
+
+/*
+ * delay_line - single channel delay line
+ *
+ * Samples are kept in a ring buffer and are moved in and out of it a block at
+ * a time with at most two contiguous copies each way.
+ *
+ * Address space for the longest delay is reserved up front but memory is
+ * only committed, and faulted in, as resize() grows the ring to suit the
+ * delay in use. run() and crossfade() never touch uncommitted memory.
+ * resize() makes system calls, so plugins call it from activate() and limit
+ * delays to capacity() in run().
+ *
+ * Output is written by the store policy S, replace for run() and accumulate
+ * for run_adding().
+ */
+class delay_line {
+public:
+	explicit delay_line(size_t max_delay);
+	delay_line(delay_line &&);
+	delay_line(const delay_line &) = delete;
+	delay_line &operator=(const delay_line &) = delete;
+	~delay_line();
+
+	/*
+	 * resize - make sure the ring can hold 'delay' samples of history
+	 *
+	 * The ring only ever grows. Returns false if memory could not be
+	 * committed, in which case delays are limited to capacity().
+	 */
+	bool resize(size_t delay);
+
+	/*
+	 * run - delay 'samples' samples by 'delay' samples
+	 *
+	 * 'delay' must be no more than capacity(), zero passes the input
+	 * through. Input and output may point to the same place.
+	 */
+	template<typename S = replace>
+	void run(const float *input, float *output, size_t delay,
+		 size_t samples, S = {});
+
+	/*
+	 * crossfade - move from 'old_delay' to 'delay' while delaying
+	 *
+	 * The output is old + (new - old) * t where t starts at t0 + step and
+	 * increases by step every sample.
+	 */
+	template<typename S = replace>
+	void crossfade(const float *input, float *output, size_t old_delay,
+		       size_t delay, float t0, float step, size_t samples,
+		       S = {});
+
+	/*
+	 * run, crossfade - as above with interpolated delays
+	 *
+	 * The delay in samples must be at least 1 and whole + 3 must be no
+	 * more than capacity().
+	 */
+	template<typename S = replace>
+	void run(const float *input, float *output,
+		 const fractional_delay &, size_t samples, S = {});
+	template<typename S = replace>
+	void crossfade(const float *input, float *output,
+		       const fractional_delay &old_delay,
+		       const fractional_delay &delay, float t0, float step,
+		       size_t samples, S = {});
+
+	/* fill the history with silence */
+	void clear();
+
+	/* append 'samples' samples of silence, for input skipped while idle */
+	void skip(size_t samples);
+
+	/* longest delay the ring can currently hold */
+	size_t capacity() const;
+
+private:
+	void write(const float *input, size_t samples);
+	template<typename S>
+	void read(float *output, size_t delay, size_t samples, S) const;
+	template<typename S>
+	void read(float *output, const fractional_delay &, size_t samples,
+		  S) const;
+	float tap(size_t start, const fractional_delay &) const;
+
+	float *ring_ = nullptr;
+	size_t reserved_ = 0;	/* in samples */
+	size_t size_ = 0;	/* in samples, power-of-two */
+	size_t pos_ = 0;	/* next write position, modulo ring size */
+};
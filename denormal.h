@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/*
+ * denormals_off - treat subnormal numbers as zero while in scope
+ *
+ * Arithmetic on subnormal numbers is many times slower than on normal numbers
+ * on most processors, and the state of a recursive filter decays into them
+ * soon after its input falls silent. Sets flush to zero, and on x86 also
+ * denormals are zero, for the calling thread and restores the previous mode
+ * on destruction so that the host is unaffected.
+ */
+class denormals_off {
+public:
+	denormals_off()
+	: saved_{get()}
+	{
+		if ((saved_ & mask) != mask)
+			set(saved_ | mask);
+	}
+
+	~denormals_off()
+	{
+		if ((saved_ & mask) != mask)
+			set(saved_);
+	}
+
+	denormals_off(const denormals_off &) = delete;
+	denormals_off &operator=(const denormals_off &) = delete;
+
+private:
+#if defined(__SSE__)
+	/* MXCSR flush to zero and denormals are zero */
+	static constexpr uint64_t mask = 0x8040;
+
+	static uint64_t get()
+	{
+		return _mm_getcsr();
+	}
+
+	static void set(uint64_t v)
+	{
+		_mm_setcsr(static_cast<unsigned>(v));
+	}
+#elif defined(__aarch64__)
+	/* FPCR flush to zero */
+	static constexpr uint64_t mask = 1 << 24;
+
+	static uint64_t get()
+	{
+		uint64_t v;
+		asm volatile("mrs %0, fpcr" : "=r"(v));
+		return v;
+	}
+
+	static void set(uint64_t v)
+	{
+		asm volatile("msr fpcr, %0" : : "r"(v));
+	}
+#elif defined(__arm__) && defined(__ARM_FP)
+	/* FPSCR flush to zero */
+	static constexpr uint64_t mask = 1 << 24;
+
+	static uint64_t get()
+	{
+		uint32_t v;
+		asm volatile("vmrs %0, fpscr" : "=r"(v));
+		return v;
+	}
+
+	static void set(uint64_t v)
+	{
+		asm volatile("vmsr fpscr, %0" : : "r"(static_cast<uint32_t>(v)));
+	}
+#else
+	static constexpr uint64_t mask = 0;
+
+	static uint64_t get()
+	{
+		return 0;
+	}
+
+	static void set(uint64_t)
+	{ }
+#endif
+
+	uint64_t saved_;
+};
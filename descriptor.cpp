@@ -14,16 +14,41 @@ std::vector<descriptor> *descriptors;
 descriptor::descriptor(const LADSPA_Descriptor &d, std::string &&label,
 		       std::string &&name)
 : d_{d}, label_{std::move(label)}, name_{std::move(name)}
+, port_descriptors_(d.PortDescriptors, d.PortDescriptors + d.PortCount)
+, port_names_(d.PortNames, d.PortNames + d.PortCount)
+, port_hints_(d.PortRangeHints, d.PortRangeHints + d.PortCount)
 {
-	d_.Label = label_.c_str();
-	d_.Name = name_.c_str();
+	port_descriptors_.push_back(LADSPA_PORT_CONTROL | LADSPA_PORT_OUTPUT);
+	port_names_.push_back("Idle");
+	port_hints_.push_back({
+		.HintDescriptor = LADSPA_HINT_TOGGLED,
+		.LowerBound = 0,
+		.UpperBound = 0,
+	});
+	d_.PortCount = size(port_descriptors_);
+	link();
 }
 
 descriptor::descriptor(descriptor &&o)
 : d_{o.d_}, label_{std::move(o.label_)}, name_{std::move(o.name_)}
+, port_descriptors_{std::move(o.port_descriptors_)}
+, port_names_{std::move(o.port_names_)}
+, port_hints_{std::move(o.port_hints_)}
+{
+	link();
+}
+
+/*
+ * descriptor::link - point the descriptor at the copied strings and ports
+ */
+void
+descriptor::link()
 {
 	d_.Label = label_.c_str();
 	d_.Name = name_.c_str();
+	d_.PortDescriptors = data(port_descriptors_);
+	d_.PortNames = data(port_names_);
+	d_.PortRangeHints = data(port_hints_);
 }
 
 const LADSPA_Descriptor *
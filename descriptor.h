@@ -2,11 +2,14 @@
 
 #include <ladspa.h>
 #include <string>
+#include <vector>
 
 /*
  * descriptor - take a copy of a LADSPA_Descriptor and change label and name
  *
  * This is helpful when using the same descriptor with different port counts.
+ * The copy also has an idle output control port appended to its ports, see
+ * idle.h.
  */
 class descriptor {
 public:
@@ -17,11 +20,27 @@ public:
 	const LADSPA_Descriptor *get();
 
 private:
+	void link();
+
 	LADSPA_Descriptor d_;
 	std::string label_;
 	std::string name_;
+	std::vector<LADSPA_PortDescriptor> port_descriptors_;
+	std::vector<const char *> port_names_;
+	std::vector<LADSPA_PortRangeHint> port_hints_;
 };
 
+/*
+ * idle_port - index of the idle port of a registered plugin
+ *
+ * The idle port follows every port of the plugin's own.
+ */
+inline unsigned long
+idle_port(const LADSPA_Descriptor *d)
+{
+	return d->PortCount - 1;
+}
+
 /*
  * register_plugin - register a plugin descriptor
  */
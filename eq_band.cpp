@@ -0,0 +1,187 @@
+#include "eq_band.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * eq_band::describe
+ */
+void
+eq_band::describe(const std::string &prefix, LADSPA_PortDescriptor *ports,
+		  std::string *names, LADSPA_PortRangeHint *hints)
+{
+	std::fill(ports, ports + controls,
+		  LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT);
+	names[0] = prefix + " Type";
+	hints[0] = {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_INTEGER |
+				  LADSPA_HINT_DEFAULT_0,
+		.LowerBound = 0,
+		.UpperBound = static_cast<int>(type::highpass),
+	};
+	names[1] = prefix + " Frequency (Hz)";
+	hints[1] = {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_SAMPLE_RATE |
+				  LADSPA_HINT_LOGARITHMIC |
+				  LADSPA_HINT_DEFAULT_MIDDLE,
+		.LowerBound = 0.0005,
+		.UpperBound = 0.45,
+	};
+	names[2] = prefix + " Gain (dB)";
+	hints[2] = {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_DEFAULT_0,
+		.LowerBound = -100,
+		.UpperBound = 100,
+	};
+	names[3] = prefix + " Bandwidth (Q)";
+	hints[3] = {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_DEFAULT_1,
+		.LowerBound = 0,
+		.UpperBound = 100,
+	};
+}
+
+/*
+ * eq_band::connect
+ */
+void
+eq_band::connect(size_t control, const LADSPA_Data *d)
+{
+	switch (control) {
+	case 0:
+		return type_.connect(d);
+	case 1:
+		return f0_.connect(d);
+	case 2:
+		return gain_.connect(d);
+	case 3:
+		return Q_.connect(d);
+	}
+}
+
+/*
+ * eq_band::update
+ */
+bool
+eq_band::update(unsigned long fs, bool &changed)
+{
+	auto retype = false;
+	if (type_.update()) {
+		/* clamp before rounding, NaN is out of range too */
+		constexpr auto last = static_cast<int>(type::highpass);
+		const LADSPA_Data v = std::isnan(type_) ? -1 : type_;
+		auto t = std::lround(std::clamp<LADSPA_Data>(v, -1, last + 1));
+		if (t < 0 || t > last) {
+			type_invalid_.raise();
+			t = 0;
+		}
+		retype = kind_ != type{static_cast<int>(t)};
+		kind_ = type{static_cast<int>(t)};
+	}
+	changed = f0_.update();
+	changed |= gain_.update();
+	changed |= Q_.update();
+	if (changed) {
+		/* frequency ramps in octaves rather than hertz */
+		const size_t len = fs * ramp_time;
+		log_f0_.set(std::log(std::max<double>(f0_, 1)), len);
+		gain_db_.set(gain_, len);
+		bandwidth_.set(Q_, len);
+	}
+
+	/* bands which are off don't need to ramp */
+	if (retype || !enabled())
+		finish();
+	changed |= retype;
+	return retype;
+}
+
+/*
+ * eq_band::report
+ */
+void
+eq_band::report()
+{
+	type_invalid_.report("WARNING: EQ band type must be between 0 and 5. Disabling band.\n");
+}
+
+/*
+ * eq_band::enabled
+ */
+bool
+eq_band::enabled() const
+{
+	return kind_ != type::off;
+}
+
+/*
+ * eq_band::ramping - check if any parameter is moving towards a new value
+ */
+bool
+eq_band::ramping() const
+{
+	return !log_f0_.settled() || !gain_db_.settled() ||
+	       !bandwidth_.settled();
+}
+
+/*
+ * eq_band::advance - advance ramps by 'samples' samples
+ */
+void
+eq_band::advance(size_t samples)
+{
+	log_f0_.advance(samples);
+	gain_db_.advance(samples);
+	bandwidth_.advance(samples);
+}
+
+/*
+ * eq_band::finish - jump ramps to their targets
+ */
+void
+eq_band::finish()
+{
+	log_f0_.finish();
+	gain_db_.finish();
+	bandwidth_.finish();
+}
+
+/*
+ * eq_band::design
+ */
+void
+eq_band::design(biquad_coefficients &c, unsigned long fs,
+		biquad_design d) const
+{
+	auto f0 = std::exp(log_f0_.value());
+	auto gain = gain_db_.value();
+	auto Q = bandwidth_.value();
+
+	switch (kind_) {
+	case type::off:
+		break;
+	case type::peaking:
+		c.peaking_eq(f0, gain, Q, fs, d);
+		break;
+	case type::low_shelf:
+		c.low_shelf(f0, gain, Q, fs, d);
+		break;
+	case type::high_shelf:
+		c.high_shelf(f0, gain, Q, fs, d);
+		break;
+	case type::lowpass:
+		c.lpf(f0, Q, fs, d);
+		break;
+	case type::highpass:
+		c.hpf(f0, Q, fs, d);
+		break;
+	}
+}
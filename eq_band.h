@@ -0,0 +1,173 @@
+#pragma once
+
+#include "biquad.h"
+#include "control.h"
+#include "smooth.h"
+#include <algorithm>
+#include <array>
+#include <ladspa.h>
+#include <string>
+
+/*
+ * eq_band - one band of a parametric equaliser
+ *
+ * Holds the type, frequency, gain & bandwidth controls of a band and ramps
+ * the frequency, gain & bandwidth towards new settings. Plugins pack the
+ * bands of an equaliser which change the signal into a biquad_cascade with
+ * pack_bands(), 'section' is the index of this band in it if 'packed', and
+ * 'draining' while it stays there only until its section is transparent.
+ */
+class eq_band {
+public:
+	enum class type {
+		off,
+		peaking,
+		low_shelf,
+		high_shelf,
+		lowpass,
+		highpass,
+	};
+
+	/* number of control ports per band */
+	static constexpr size_t controls = 4;
+
+	/*
+	 * describe - fill in descriptors, names & hints of the band's controls
+	 *
+	 * 'prefix' is prepended to each port name, e.g. "Band 1".
+	 */
+	static void describe(const std::string &prefix, LADSPA_PortDescriptor *,
+			     std::string *names, LADSPA_PortRangeHint *);
+
+	void connect(size_t control, const LADSPA_Data *);
+
+	/*
+	 * update - latch controls and retarget the ramps if they have changed
+	 *
+	 * Returns true if the type of the band has changed, in which case the
+	 * ramps are finished so that the band starts at its new settings.
+	 * 'changed' is set if the band needs to be designed again.
+	 */
+	bool update(unsigned long fs, bool &changed);
+
+	/* report - print warnings about controls corrected by update() */
+	void report();
+
+	bool enabled() const;
+	bool ramping() const;
+	void advance(size_t samples);
+	void finish();
+
+	/* design coefficients for the current ramp values */
+	void design(biquad_coefficients &, unsigned long fs,
+		    biquad_design = biquad_design::exact) const;
+
+	size_t section = 0;
+	bool packed = false;
+	bool draining = false;
+
+private:
+	control_port type_, f0_, gain_, Q_;
+	control_warning type_invalid_;
+	ramp log_f0_, gain_db_, bandwidth_;
+	type kind_ = type::off;
+};
+
+/*
+ * pack_bands - pack the bands which change the signal into a cascade
+ *
+ * Bands which are off, and bands settled at settings which pass the signal
+ * through unchanged such as peaking and shelving bands at 0dB, take no
+ * section. The rest are packed in order from section 'first' onwards, with
+ * sections inserted and erased for channels 'begin' to 'end' of 'bq' as
+ * bands come and go so that the output of the others is undisturbed. Bands
+ * which have just settled at such settings, or been switched off, stay until
+ * their sections are transparent, 'draining' is set while any do and they
+ * should be passed to drain_bands() later. Every enabled band is designed,
+ * bands which are off pass their input through while they drain. Returns the
+ * new number of sections, 'sections' is the current number and sections past
+ * the end are identities.
+ */
+template<size_t N, size_t B>
+size_t
+pack_bands(std::array<eq_band, B> &bands, std::array<biquad_coefficients, N> &c,
+	   biquad_cascade<N> &bq, size_t first, size_t sections, size_t begin,
+	   size_t end, unsigned long fs, bool &draining)
+{
+	draining = false;
+	auto k = first;
+	for (auto &b : bands) {
+		biquad_coefficients d;
+		auto want = b.enabled();
+		if (want) {
+			b.design(d, fs);
+			want = b.ramping() || !d.passthrough();
+		} else
+			d.identity();
+		b.draining = b.packed && !want &&
+			     !bq.transparent(k, begin, end);
+		if (b.draining) {
+			draining = true;
+			want = true;
+		}
+		if (b.packed && !want) {
+			for (auto ch = begin; ch < end; ++ch)
+				bq.erase(k, ch);
+			std::copy(std::begin(c) + k + 1,
+				  std::begin(c) + sections, std::begin(c) + k);
+			c[--sections].identity();
+			b.packed = false;
+		} else if (!b.packed && want) {
+			for (auto ch = begin; ch < end; ++ch)
+				bq.insert(k, ch);
+			std::copy_backward(std::begin(c) + k,
+					   std::begin(c) + sections,
+					   std::begin(c) + sections + 1);
+			++sections;
+			b.packed = true;
+		}
+		if (!b.packed)
+			continue;
+		b.section = k;
+		c[k++] = d;
+	}
+	return sections;
+}
+
+/*
+ * drain_bands - remove the sections of draining bands which have become
+ * transparent
+ *
+ * As pack_bands(), but only checks the bands which are draining and leaves
+ * the coefficients of the rest as they are. 'draining' stays set while any
+ * band is still draining.
+ */
+template<size_t N, size_t B>
+size_t
+drain_bands(std::array<eq_band, B> &bands,
+	    std::array<biquad_coefficients, N> &c, biquad_cascade<N> &bq,
+	    size_t sections, size_t begin, size_t end, bool &draining)
+{
+	draining = false;
+	size_t removed = 0;
+	for (auto &b : bands) {
+		if (!b.packed)
+			continue;
+		const auto k = b.section -= removed;
+		if (!b.draining)
+			continue;
+		if (!bq.transparent(k, begin, end)) {
+			draining = true;
+			continue;
+		}
+		for (auto ch = begin; ch < end; ++ch)
+			bq.erase(k, ch);
+		std::copy(std::begin(c) + k + 1, std::begin(c) + sections,
+			  std::begin(c) + k);
+		c[--sections].identity();
+		b.packed = false;
+		b.draining = false;
+		++removed;
+	}
+	return sections;
+}
@@ -0,0 +1,186 @@
+#include "fft.h"
+
+#include "simd.h"
+#include <cmath>
+#include <numbers>
+
+/*
+ * The real transform of 2n samples is computed with a complex transform of n
+ * points, treating even samples as the real parts and odd samples as the
+ * imaginary parts, followed by a pass which separates the two interleaved
+ * spectra. See for example Numerical Recipes, section 12.3.
+ */
+namespace {
+
+/*
+ * butterflies - one radix-2 decimation in time pass over n points
+ *
+ * Combines pairs of transforms of 'half' points into transforms of twice the
+ * size. Split form keeps the inner loop free of shuffles so that it
+ * vectorises once 'half' is large enough.
+ */
+simd_clones void
+butterflies(float *__restrict re, float *__restrict im,
+	    const float *__restrict wr, const float *__restrict wi,
+	    size_t n, size_t half)
+{
+	for (size_t i = 0; i < n; i += 2 * half) {
+		float *ar = re + i, *ai = im + i;
+		float *br = ar + half, *bi = ai + half;
+		for (size_t j = 0; j < half; ++j) {
+			const auto tr = br[j] * wr[j] - bi[j] * wi[j];
+			const auto ti = br[j] * wi[j] + bi[j] * wr[j];
+			br[j] = ar[j] - tr;
+			bi[j] = ai[j] - ti;
+			ar[j] += tr;
+			ai[j] += ti;
+		}
+	}
+}
+
+}
+
+/*
+ * fft
+ */
+fft::fft(size_t size)
+: n_{size / 2}
+, bitrev_(n_)
+, tw_re_(n_)
+, tw_im_(n_)
+, post_re_(n_)
+, post_im_(n_)
+, re_(n_)
+, im_(n_)
+{
+	using std::numbers::pi;
+	for (size_t k = 0, r = 0; k < n_; ++k) {
+		bitrev_[k] = r;
+		/* increment r with the bits in reverse order */
+		auto bit = n_ / 2;
+		for (; r & bit; bit /= 2)
+			r ^= bit;
+		r |= bit;
+	}
+
+	/* twiddles of the pass combining transforms of 'half' points start at
+	 * index 'half' */
+	for (size_t half = 1; half < n_; half *= 2) {
+		for (size_t j = 0; j < half; ++j) {
+			tw_re_[half + j] = std::cos(-pi * j / half);
+			tw_im_[half + j] = std::sin(-pi * j / half);
+		}
+	}
+	for (size_t k = 0; k < n_; ++k) {
+		post_re_[k] = std::cos(-pi * k / n_);
+		post_im_[k] = std::sin(-pi * k / n_);
+	}
+}
+
+/*
+ * fft::size
+ */
+size_t
+fft::size() const
+{
+	return 2 * n_;
+}
+
+/*
+ * fft::transform - complex transform of the bit reversed work space
+ */
+void
+fft::transform()
+{
+	for (size_t half = 1; half < n_; half *= 2)
+		butterflies(re_.data(), im_.data(), &tw_re_[half],
+			    &tw_im_[half], n_, half);
+}
+
+/*
+ * fft::forward
+ */
+void
+fft::forward(const float *input, float *re, float *im)
+{
+	for (size_t k = 0; k < n_; ++k) {
+		re_[bitrev_[k]] = input[2 * k];
+		im_[bitrev_[k]] = input[2 * k + 1];
+	}
+	transform();
+
+	/* separate the spectra of the even and odd samples, fe & fo, and
+	 * combine them into bins k and n - k at once */
+	re[0] = re_[0] + im_[0];
+	im[0] = re_[0] - im_[0];
+	for (size_t k = 1; k <= n_ / 2; ++k) {
+		const auto ar = re_[k], ai = im_[k];
+		const auto br = re_[n_ - k], bi = im_[n_ - k];
+		const auto fer = 0.5f * (ar + br), fei = 0.5f * (ai - bi);
+		const auto for_ = 0.5f * (ai + bi), foi = -0.5f * (ar - br);
+		const auto wr = post_re_[k], wi = post_im_[k];
+		const auto tr = wr * for_ - wi * foi;
+		const auto ti = wr * foi + wi * for_;
+		re[k] = fer + tr;
+		im[k] = fei + ti;
+		re[n_ - k] = fer - tr;
+		im[n_ - k] = -(fei - ti);
+	}
+}
+
+/*
+ * fft::inverse
+ */
+void
+fft::inverse(const float *re, const float *im, float *output)
+{
+	/* rebuild the complex spectrum of the interleaved samples, conjugated
+	 * so that the forward transform computes the inverse */
+	re_[0] = re[0] + im[0];
+	im_[0] = -(re[0] - im[0]);
+	for (size_t k = 1; k <= n_ / 2; ++k) {
+		const auto ar = re[k], ai = im[k];
+		const auto br = re[n_ - k], bi = im[n_ - k];
+		/* fe = X[k] + conj(X[n - k]), fo = (X[k] - conj(X[n - k])) *
+		 * conj(w^k) */
+		const auto fer = ar + br, fei = ai - bi;
+		const auto dr = ar - br, di = ai + bi;
+		const auto wr = post_re_[k], wi = -post_im_[k];
+		const auto for_ = dr * wr - di * wi;
+		const auto foi = dr * wi + di * wr;
+		/* z[k] = fe + i * fo, z[n - k] = conj(fe) + i * conj(fo) */
+		const auto p = bitrev_[k], q = bitrev_[n_ - k];
+		re_[p] = fer - foi;
+		im_[p] = -(fei + for_);
+		re_[q] = fer + foi;
+		im_[q] = -(for_ - fei);
+	}
+	transform();
+	for (size_t k = 0; k < n_; ++k) {
+		output[2 * k] = re_[k];
+		output[2 * k + 1] = -im_[k];
+	}
+}
+
+/*
+ * fft::multiply_accumulate
+ *
+ * Bin 0 holds the real DC and Nyquist bins in its real and imaginary parts,
+ * so it is multiplied part by part.
+ */
+simd_clones void
+fft::multiply_accumulate(float *__restrict acc_re, float *__restrict acc_im,
+			 const float *__restrict x_re,
+			 const float *__restrict x_im,
+			 const float *__restrict h_re,
+			 const float *__restrict h_im, size_t bins)
+{
+	const auto dc = acc_re[0] + x_re[0] * h_re[0];
+	const auto nyquist = acc_im[0] + x_im[0] * h_im[0];
+	for (size_t k = 0; k < bins; ++k) {
+		acc_re[k] += x_re[k] * h_re[k] - x_im[k] * h_im[k];
+		acc_im[k] += x_re[k] * h_im[k] + x_im[k] * h_re[k];
+	}
+	acc_re[0] = dc;
+	acc_im[0] = nyquist;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * fft - fast Fourier transform of real data
+ *
+ * Transforms 'size' real samples to size / 2 + 1 complex bins. Bins are kept
+ * in split form, real and imaginary parts in separate arrays of size / 2
+ * floats, with the real valued Nyquist bin packed into the imaginary part of
+ * bin 0 which is otherwise always zero.
+ *
+ * Neither direction is normalised, so a forward then inverse transform scales
+ * the data by 'size'. Tables and work space are allocated by the constructor
+ * and transforms never allocate.
+ */
+class fft {
+public:
+	/* 'size' must be a power of two, at least 4 */
+	explicit fft(size_t size);
+
+	size_t size() const;
+	void forward(const float *input, float *re, float *im);
+	void inverse(const float *re, const float *im, float *output);
+
+	/* acc += x * h for spectra of 'bins' bins in the form used here */
+	static void multiply_accumulate(float *acc_re, float *acc_im,
+					const float *x_re, const float *x_im,
+					const float *h_re, const float *h_im,
+					size_t bins);
+
+private:
+	void transform();
+
+	size_t n_;				/* complex points, size / 2 */
+	std::vector<uint32_t> bitrev_;
+	std::vector<float> tw_re_, tw_im_;	/* twiddles of every pass */
+	std::vector<float> post_re_, post_im_;	/* e^(-i * pi * k / n_) */
+	std::vector<float> re_, im_;		/* work space */
+};
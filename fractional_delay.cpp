@@ -0,0 +1,326 @@
+#include "control.h"
+#include "delay_line.h"
+#include "denormal.h"
+#include "descriptor.h"
+#include "idle.h"
+#include "io.h"
+#include "ladspa_ids.h"
+#include "smooth.h"
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr auto control = 1;
+constexpr auto channels = 8;
+constexpr auto max_delay_ms = 5000;
+
+struct filter {
+	control_port delay_ms;
+	control_warning delay_low, delay_high, uncommitted;
+	double wanted = 1;		/* in samples, as set by the control */
+	double delay = 1;		/* in samples */
+	fractional_delay head, old_head;
+	ramp fade;			/* from old_head to head */
+	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
+	std::vector<delay_line> lines;
+	unsigned long max_delay = 1;	/* in samples */
+	unsigned long fs = 0;
+	idle_tracker idle;
+};
+
+LADSPA_Handle
+instantiate(const LADSPA_Descriptor *d, unsigned long fs)
+{
+	auto p = new filter;
+	p->fs = fs;
+	p->idle.init(d);
+	p->max_delay = std::max<unsigned long>(1, max_delay_ms / 1000.0 * fs);
+	const auto n = (idle_port(d) - control) / 2;
+	p->lines.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+		p->lines.emplace_back(p->max_delay);
+	return p;
+}
+
+void
+connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+
+	if (p->idle.connect(port, d))
+		return;
+	switch (port) {
+	case 0:
+		p->delay_ms.connect(d);
+		return;
+	}
+	port -= control;
+	if (port >= 2 * channels)
+		return;
+	p->io[port / 2][port % 2] = d;
+}
+
+/*
+ * latch - recompute the wanted delay, returns true if the control changed
+ */
+bool
+latch(filter *p)
+{
+	if (!p->delay_ms.update())
+		return false;
+
+	double delay = p->delay_ms / 1000.0 * p->fs;
+	if (std::isnan(delay) || delay < 1) {
+		p->delay_low.raise();
+		delay = 1;
+	}
+	if (delay > p->max_delay) {
+		p->delay_high.raise();
+		delay = p->max_delay;
+	}
+	p->wanted = delay;
+	return true;
+}
+
+/*
+ * retarget - move to the wanted delay as far as the lines can hold it
+ */
+void
+retarget(filter *p)
+{
+	/* interpolation needs the three samples after whole */
+	auto delay = p->wanted;
+	for (auto &line : p->lines)
+		delay = std::min<double>(delay, line.capacity() - 2);
+	if (delay == p->delay)
+		return;
+	p->delay = delay;
+
+	/* first setting, nothing to fade from */
+	if (p->fade.target() != 1) {
+		p->head = fractional_delay{delay};
+		p->fade.jump(1);
+		return;
+	}
+
+	/* crossfade to the new read position from whichever one dominates
+	 * the output right now */
+	if (p->fade.value() >= 0.5)
+		p->old_head = p->head;
+	p->head = fractional_delay{delay};
+	p->fade.jump(0);
+	p->fade.set(1, p->fs * ramp_time);
+}
+
+/*
+ * update - retarget the delay if the control has changed
+ *
+ * Committing memory may block, so only activate() grows the lines. Longer
+ * delays set while running are limited to what the lines can hold until the
+ * plugin is activated again.
+ */
+void
+update(filter *p)
+{
+	if (!latch(p))
+		return;
+	retarget(p);
+	if (p->delay < p->wanted)
+		p->uncommitted.raise();
+}
+
+/*
+ * report - print warnings about controls corrected since the last report
+ */
+void
+report(filter *p)
+{
+	p->delay_low.report("WARNING: Minimum delay is %.2fms at %luHz. Clamping.\n",
+			    1000.0 / p->fs, p->fs);
+	p->delay_high.report("WARNING: Maximum delay is %.2fms at %luHz. Clamping.\n",
+			     p->max_delay * 1000.0 / p->fs, p->fs);
+	p->uncommitted.report("WARNING: Delay increased while running. Limiting it until the plugin is activated again.\n");
+}
+
+void
+activate(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	latch(p);
+	for (auto &line : p->lines) {
+		if (line.resize(fractional_delay{p->wanted}.whole + 3))
+			continue;
+		fprintf(stderr, "WARNING: Out of memory for %.2fms delay. Clamping.\n",
+			p->wanted * 1000.0 / p->fs);
+		break;
+	}
+	retarget(p);
+	report(p);
+	p->idle.reset();
+	p->fade.jump(1);
+}
+
+void
+deactivate(LADSPA_Handle h)
+{
+	report(reinterpret_cast<filter *>(h));
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
+
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence once everything in the lines is silence, and catch
+	 * them up with the silence skipped when the input returns */
+	const auto tail = p->head.whole + 3;
+	const auto idle = p->idle.quiet(data(in), n, samples, tail) &&
+			  p->fade.settled();
+	if (p->idle.set(idle, samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+	if (auto skipped = p->idle.resume())
+		for (size_t c = 0; c < n; ++c)
+			p->lines[c].skip(skipped);
+
+	/* crossfade sample by sample until the fade settles */
+	const auto len = std::min<unsigned long>(samples, p->fade.remaining());
+	const LADSPA_Data t0 = p->fade.value();
+	const LADSPA_Data step = p->fade.step();
+	for (size_t c = 0; c < n; ++c) {
+		auto &line = p->lines[c];
+		line.crossfade(in[c], out[c], p->old_head, p->head, t0, step,
+			       len, store);
+		line.run(in[c] + len, out[c] + len, p->head, samples - len,
+			 store);
+	}
+	p->fade.advance(samples);
+}
+
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
+}
+
+void
+cleanup(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	delete p;
+}
+
+constexpr std::array<LADSPA_PortDescriptor, control + 2 * channels> ports = {
+	LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+	LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
+};
+constexpr std::array<const char *, size(ports)> port_names = {
+	"Delay (ms)",
+	"Channel 1 Input",
+	"Channel 1 Output",
+	"Channel 2 Input",
+	"Channel 2 Output",
+	"Channel 3 Input",
+	"Channel 3 Output",
+	"Channel 4 Input",
+	"Channel 4 Output",
+	"Channel 5 Input",
+	"Channel 5 Output",
+	"Channel 6 Input",
+	"Channel 6 Output",
+	"Channel 7 Input",
+	"Channel 7 Output",
+	"Channel 8 Input",
+	"Channel 8 Output",
+};
+constexpr std::array<LADSPA_PortRangeHint, size(ports)> port_hints = { { {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_DEFAULT_1,
+		.LowerBound = 0,
+		.UpperBound = max_delay_ms,
+	}
+} };
+
+/*
+ * register plugin instances
+ */
+struct init {
+	init()
+	{
+		LADSPA_Descriptor d = {
+			.UniqueID = 0,
+			.Label = nullptr,
+			.Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+			.Name = nullptr,
+			.Maker = "Patrick Oppenlander <patrick.oppenlander@gmail.com>",
+			.Copyright = "Patrick Oppenlander, 2021",
+			.PortCount = 0,
+			.PortDescriptors = data(ports),
+			.PortNames = data(port_names),
+			.PortRangeHints = data(port_hints),
+			.ImplementationData = nullptr,
+			.instantiate = instantiate,
+			.connect_port = connect_port,
+			.activate = activate,
+			.run = run,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
+			.deactivate = deactivate,
+			.cleanup = cleanup,
+		};
+
+		for (int i = 0; i < channels; ++i) {
+			d.UniqueID = ladspa_ids::fractional_delay + i;
+			d.PortCount = control + (i + 1) * 2;
+			register_plugin({d,
+			    "fractional_delay_" + std::to_string(i + 1) + "ch",
+			    "Fractional Delay (" + std::to_string(i + 1) + " Channel)"});
+		}
+	}
+} init;
+
+} /* namespace */
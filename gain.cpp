@@ -1,6 +1,12 @@
 #include "biquad.h"
+#include "control.h"
+#include "denormal.h"
 #include "descriptor.h"
+#include "idle.h"
+#include "io.h"
 #include "ladspa_ids.h"
+#include "smooth.h"
+#include "store.h"
 #include <array>
 #include <cmath>
 
@@ -10,14 +16,21 @@ constexpr auto control = 1;
 constexpr auto channels = 8;
 
 struct filter {
-	LADSPA_Data gain;
+	control_port gain_db;
+	ramp gain;
 	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
+	unsigned long fs = 0;
+	idle_tracker idle;
 };
 
 LADSPA_Handle
 instantiate(const LADSPA_Descriptor *d, unsigned long fs)
 {
-	return new filter;
+	auto p = new filter;
+	p->fs = fs;
+	p->idle.init(d);
+	return p;
 }
 
 void
@@ -25,10 +38,11 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 {
 	filter *p = reinterpret_cast<filter *>(h);
 
+	if (p->idle.connect(port, d))
+		return;
 	switch (port) {
 	case 0:
-		/* db->magnitude */
-		p->gain = std::pow(10.0, *d / 20.0);
+		p->gain_db.connect(d);
 		return;
 	}
 	port -= control;
@@ -37,19 +51,87 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 	p->io[port / 2][port % 2] = d;
 }
 
+/*
+ * update - retarget the gain ramp if the control has changed
+ */
 void
-run(LADSPA_Handle h, unsigned long samples)
+update(filter *p)
+{
+	/* db->magnitude */
+	if (p->gain_db.update())
+		p->gain.set(std::pow(10.0, p->gain_db / 20.0),
+			    p->fs * ramp_time);
+}
+
+void
+activate(LADSPA_Handle h)
 {
 	filter *p = reinterpret_cast<filter *>(h);
-	for (auto i = 0; i < channels; ++i) {
-		auto in = p->io[i][0];
-		auto out = p->io[i][1];
-		/* stop on first unconnected port */
-		if (!in || !out)
-			return;
-		for (unsigned long j = 0; j < samples; ++j)
-			out[j] = in[j] * p->gain;
+	update(p);
+	p->idle.reset();
+	p->gain.finish();
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
+
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence while silence goes in and the gain is steady */
+	const auto idle = p->idle.quiet(data(in), n, samples) &&
+			  p->gain.settled();
+	if (p->idle.set(idle, samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+
+	/* ramp sample by sample until the gain settles */
+	const auto len = std::min<unsigned long>(samples, p->gain.remaining());
+	const LADSPA_Data g0 = p->gain.value();
+	const LADSPA_Data step = p->gain.step();
+	const LADSPA_Data g = p->gain.target();
+	for (size_t c = 0; c < n; ++c) {
+		for (unsigned long j = 0; j < len; ++j)
+			store(out[c][j], in[c][j] * (g0 + step * (j + 1)));
+		/* unity gain is a copy, or nothing at all in place */
+		if (g == 1) {
+			store.block(out[c] + len, in[c] + len, samples - len);
+			continue;
+		}
+		for (unsigned long j = len; j < samples; ++j)
+			store(out[c][j], in[c][j] * g);
 	}
+	p->gain.advance(samples);
+}
+
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
 }
 
 void
@@ -126,10 +208,10 @@ struct init {
 			.ImplementationData = nullptr,
 			.instantiate = instantiate,
 			.connect_port = connect_port,
-			.activate = nullptr,
+			.activate = activate,
 			.run = run,
-			.run_adding = nullptr,
-			.set_run_adding_gain = nullptr,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
 			.deactivate = nullptr,
 			.cleanup = cleanup,
 		};
@@ -0,0 +1,22 @@
+#include "idle.h"
+
+#include "simd.h"
+#include <cmath>
+
+/*
+ * silent
+ */
+simd_clones bool
+silent(const float *const *input, size_t channels, size_t samples)
+{
+	for (size_t c = 0; c < channels; ++c) {
+		/* no early exit, and an integer mask rather than a bool, so that
+		 * the scan vectorises */
+		int loud = 0;
+		for (size_t i = 0; i < samples; ++i)
+			loud |= -(std::abs(input[c][i]) > silence);
+		if (loud)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "descriptor.h"
+#include <cstddef>
+#include <ladspa.h>
+
+/*
+ * silence - magnitude below which samples are treated as silence, -160dB
+ */
+constexpr float silence = 1e-8f;
+
+/*
+ * silent - check if 'samples' samples of each of 'channels' buffers are
+ * silence
+ */
+bool silent(const float *const *input, size_t channels, size_t samples);
+
+/*
+ * store_silence - store silence to an output unless it is also the input
+ *
+ * Buffers shared with a silent input already hold silence.
+ */
+template<typename S>
+void
+store_silence(const float *input, float *output, size_t samples, S store)
+{
+	if (output != input)
+		store.silence(output, samples);
+}
+
+template<typename S>
+void
+store_silence(const float *const *input, float *const *output,
+	      size_t channels, size_t samples, S store)
+{
+	for (size_t c = 0; c < channels; ++c)
+		store_silence(input[c], output[c], samples, store);
+}
+
+/*
+ * idle_tracker - decide when a plugin can stop processing
+ *
+ * A plugin is idle for a run once its input has been silent for that run and
+ * for its tail before it, the time its state takes to forget its input, and
+ * its state is quiet. Its outputs are then silent too, so rather than running
+ * it stores silence to every output.
+ *
+ * Plugins report whether they are idle through the idle port which
+ * descriptor appends to every plugin, 1 while idle and 0 otherwise, so that
+ * hosts can skip processing downstream too.
+ */
+class idle_tracker {
+public:
+	void init(const LADSPA_Descriptor *d)
+	{
+		port_index_ = idle_port(d);
+	}
+
+	/* connect 'd' if 'port' is the idle port, returns true if it is */
+	bool connect(unsigned long port, LADSPA_Data *d)
+	{
+		if (port != port_index_)
+			return false;
+		port_ = d;
+		return true;
+	}
+
+	/*
+	 * quiet - account for the next 'samples' samples of input
+	 *
+	 * Returns true if the input is silent for these samples and was for at
+	 * least 'tail' samples before them. Must be called every run.
+	 */
+	bool quiet(const float *const *input, size_t channels, size_t samples,
+		   size_t tail = 0)
+	{
+		if (silent(input, channels, samples))
+			quiet_ += samples;
+		else
+			quiet_ = 0;
+		return quiet_ >= samples + tail;
+	}
+
+	/* set - report whether this run is idle, returns 'idle' */
+	bool set(bool idle, size_t samples)
+	{
+		if (port_)
+			*port_ = idle;
+		if (idle)
+			skipped_ += samples;
+		return idle;
+	}
+
+	/*
+	 * resume - samples skipped while idle since the last call
+	 *
+	 * Plugins with state which runs on for a fixed time, like a delay
+	 * line, feed this much silence to it before running again.
+	 */
+	size_t resume()
+	{
+		auto n = skipped_;
+		skipped_ = 0;
+		return n;
+	}
+
+	/* forget the input, as on activate */
+	void reset()
+	{
+		quiet_ = 0;
+		skipped_ = 0;
+	}
+
+private:
+	unsigned long port_index_ = 0;
+	LADSPA_Data *port_ = nullptr;
+	size_t quiet_ = 0;	/* samples since the input was last loud */
+	size_t skipped_ = 0;	/* samples skipped while idle */
+};
@@ -0,0 +1,130 @@
+#include "impulse_response.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr uint16_t format_pcm = 1;
+constexpr uint16_t format_float = 3;
+constexpr uint16_t format_extensible = 0xfffe;
+
+/* WAV files are little endian regardless of the host */
+uint32_t
+le(const unsigned char *p, size_t bytes)
+{
+	uint32_t v = 0;
+	for (size_t i = 0; i < bytes; ++i)
+		v |= uint32_t{p[i]} << 8 * i;
+	return v;
+}
+
+/*
+ * sample - convert one sample to float
+ */
+float
+sample(const unsigned char *p, uint16_t format, uint16_t bits)
+{
+	if (format == format_float) {
+		float f;
+		const auto v = le(p, 4);
+		memcpy(&f, &v, sizeof(f));
+		return f;
+	}
+	/* shift to the top of 32 bits to sign extend */
+	const auto v = static_cast<int32_t>(le(p, bits / 8) << (32 - bits));
+	return v * 0x1p-31f;
+}
+
+struct file_closer {
+	void operator()(FILE *f) const
+	{
+		fclose(f);
+	}
+};
+
+}
+
+/*
+ * read_impulse_response
+ */
+bool
+read_impulse_response(const char *path, size_t max_length,
+		      impulse_response &ir)
+{
+	std::unique_ptr<FILE, file_closer> f{fopen(path, "rb")};
+	if (!f) {
+		fprintf(stderr, "WARNING: Failed to open %s: %s.\n", path,
+			strerror(errno));
+		return false;
+	}
+
+	unsigned char riff[12];
+	if (fread(riff, sizeof(riff), 1, f.get()) != 1 ||
+	    memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+		fprintf(stderr, "WARNING: %s is not a WAV file.\n", path);
+		return false;
+	}
+
+	uint16_t format = 0, channels = 0, bits = 0;
+	unsigned char chunk[8];
+	while (fread(chunk, sizeof(chunk), 1, f.get()) == 1) {
+		const auto size = le(chunk + 4, 4);
+		if (!memcmp(chunk, "fmt ", 4)) {
+			unsigned char fmt[40] = {};
+			if (size < 16 || size > sizeof(fmt) ||
+			    fread(fmt, size, 1, f.get()) != 1)
+				break;
+			format = le(fmt, 2);
+			channels = le(fmt + 2, 2);
+			ir.rate = le(fmt + 4, 4);
+			bits = le(fmt + 14, 2);
+			/* sub format GUID starts with the format code */
+			if (format == format_extensible && size >= 26)
+				format = le(fmt + 24, 2);
+		} else if (!memcmp(chunk, "data", 4)) {
+			if (!channels)
+				break;
+			const bool pcm = format == format_pcm &&
+			    (bits == 16 || bits == 24 || bits == 32);
+			const bool flt = format == format_float && bits == 32;
+			if (!pcm && !flt) {
+				fprintf(stderr, "WARNING: %s: unsupported format %u with %u bit samples.\n",
+					path, format, bits);
+				return false;
+			}
+
+			const size_t frame = channels * bits / 8;
+			auto length = size / frame;
+			if (length > max_length) {
+				fprintf(stderr, "WARNING: %s: maximum length is %zu samples. Truncating.\n",
+					path, max_length);
+				length = max_length;
+			}
+			std::vector<unsigned char> data(length * frame);
+			if (fread(data.data(), frame, length, f.get()) != length)
+				break;
+			ir.channels.assign(channels,
+					   std::vector<float>(length));
+			for (size_t i = 0; i < length; ++i) {
+				for (size_t c = 0; c < channels; ++c) {
+					const auto p = &data[i * frame +
+							     c * bits / 8];
+					ir.channels[c][i] =
+					    sample(p, format, bits);
+				}
+			}
+			return true;
+		} else {
+			/* chunks are padded to an even size */
+			if (fseek(f.get(), size + (size & 1), SEEK_CUR))
+				break;
+		}
+	}
+
+	fprintf(stderr, "WARNING: %s: truncated or malformed WAV file.\n", path);
+	return false;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * impulse_response - impulse response read from a WAV file
+ *
+ * Supports 16, 24 and 32 bit integer and 32 bit float samples, in plain or
+ * extensible format. Samples are converted to float with one vector per
+ * channel.
+ */
+struct impulse_response {
+	unsigned long rate = 0;
+	std::vector<std::vector<float>> channels;
+};
+
+/*
+ * read_impulse_response - read a WAV file, at most 'max_length' samples long
+ *
+ * Returns false and prints a warning on error.
+ */
+bool read_impulse_response(const char *path, size_t max_length,
+			   impulse_response &);
@@ -1,6 +1,10 @@
 #include "biquad.h"
+#include "denormal.h"
 #include "descriptor.h"
+#include "idle.h"
+#include "io.h"
 #include "ladspa_ids.h"
+#include "store.h"
 #include <array>
 #include <cmath>
 
@@ -10,12 +14,16 @@ constexpr auto channels = 8;
 
 struct filter {
 	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
+	idle_tracker idle;
 };
 
 LADSPA_Handle
 instantiate(const LADSPA_Descriptor *d, unsigned long fs)
 {
-	return new filter;
+	auto p = new filter;
+	p->idle.init(d);
+	return p;
 }
 
 void
@@ -23,24 +31,55 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 {
 	filter *p = reinterpret_cast<filter *>(h);
 
+	if (p->idle.connect(port, d))
+		return;
 	if (port >= 2 * channels)
 		return;
 	p->io[port / 2][port % 2] = d;
 }
 
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence while silence goes in */
+	if (p->idle.set(p->idle.quiet(data(in), n, samples), samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+
+	for (size_t c = 0; c < n; ++c)
+		for (unsigned long j = 0; j < samples; ++j)
+			store(out[c][j], -in[c][j]);
+}
+
 void
 run(LADSPA_Handle h, unsigned long samples)
 {
 	filter *p = reinterpret_cast<filter *>(h);
-	for (auto i = 0; i < channels; ++i) {
-		auto in = p->io[i][0];
-		auto out = p->io[i][1];
-		/* stop on first unconnected port */
-		if (!in || !out)
-			return;
-		for (unsigned long j = 0; j < samples; ++j)
-			out[j] = -in[j];
-	}
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
 }
 
 void
@@ -110,8 +149,8 @@ struct init {
 			.connect_port = connect_port,
 			.activate = nullptr,
 			.run = run,
-			.run_adding = nullptr,
-			.set_run_adding_gain = nullptr,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
 			.deactivate = nullptr,
 			.cleanup = cleanup,
 		};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <ladspa.h>
+
+/*
+ * connected_channels - gather input & output buffers of connected channels
+ *
+ * Stops on the first unconnected port and returns the number of channels
+ * gathered.
+ */
+template<size_t N>
+size_t
+connected_channels(const std::array<std::array<LADSPA_Data *, 2>, N> &io,
+		   std::array<const LADSPA_Data *, N> &in,
+		   std::array<LADSPA_Data *, N> &out)
+{
+	size_t n = 0;
+	for (; n < N; ++n) {
+		if (!io[n][0] || !io[n][1])
+			break;
+		in[n] = io[n][0];
+		out[n] = io[n][1];
+	}
+	return n;
+}
+
+/*
+ * advance_channels - advance channel buffers past 'samples' samples
+ */
+template<size_t N>
+void
+advance_channels(std::array<const LADSPA_Data *, N> &in,
+		 std::array<LADSPA_Data *, N> &out, size_t channels,
+		 size_t samples)
+{
+	for (size_t i = 0; i < channels; ++i) {
+		in[i] += samples;
+		out[i] += samples;
+	}
+}
@@ -13,5 +13,17 @@ constexpr auto invert = 148;
 constexpr auto gain = 156;
 constexpr auto butterworth_lowpass = 164;
 constexpr auto butterworth_highpass = 172;
+constexpr auto fractional_delay = 180;
+constexpr auto crossover_2way = 188;
+constexpr auto crossover_3way = 196;
+constexpr auto crossover_4way = 204;
+constexpr auto parametric_eq_4band = 212;
+constexpr auto parametric_eq_8band = 220;
+constexpr auto parametric_eq_16band = 228;
+constexpr auto speaker_processor = 236;
+constexpr auto convolver = 244;
+constexpr auto linear_phase_crossover_2way = 252;
+constexpr auto linear_phase_crossover_3way = 260;
+constexpr auto linear_phase_crossover_4way = 268;
 
 }
@@ -0,0 +1,643 @@
+#include "control.h"
+#include "convolution_bank.h"
+#include "delay_line.h"
+#include "denormal.h"
+#include "descriptor.h"
+#include "fft.h"
+#include "idle.h"
+#include "ladspa_ids.h"
+#include "partitioned_convolution.h"
+#include "smooth.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto channels = 8;
+
+/* samples of input copied to scratch at a time */
+constexpr auto block = 256;
+
+/*
+ * filter - linear phase crossover with N bands
+ *
+ * Each band is a linear phase FIR filter with the magnitude response of the
+ * Linkwitz Riley crossover with the same parameters. A Linkwitz Riley
+ * lowpass and highpass of order n have magnitudes 1 / (1 + r) and r / (1 + r)
+ * where r = (f / f0)^n, which sum to exactly 1, so the zero phase bands of a
+ * tree of splits sum to exactly 1. The filters are designed by sampling the
+ * band magnitudes, transforming to a zero phase impulse response, and
+ * delaying and windowing that to 'taps' samples. Windowing keeps the centre
+ * tap, so the bands still sum to a pure delay.
+ *
+ * All bands but the last run through one convolution bank so that the
+ * transform of each channel's input is shared. The last band is the delayed
+ * input less the other bands, which saves its convolution and makes the bands
+ * complementary by construction.
+ *
+ * Filters are about a third of a second long for good resolution at low
+ * crossover frequencies, which makes designing them too slow for run(). The
+ * bank holds two sets of filters. A worker thread designs new settings into
+ * the set which is not in use, then run() enables it and crossfades to it
+ * over ramp_time from the next block of the bank, and the old set is
+ * disabled once the fade is over. Settings which change while this is going
+ * on are designed next.
+ */
+template<size_t N>
+struct filter {
+	static constexpr auto splits = N - 1;
+	static constexpr auto control = splits + 2;
+
+	/* band filter design parameters */
+	struct settings {
+		std::array<float, splits> f = {};
+		unsigned order = 4;
+
+		bool operator==(const settings &) const = default;
+	};
+
+	/* progress from one set of filters to the other */
+	enum class stage {
+		settled,	/* only the active set is in use */
+		designing,	/* the worker is designing the other set */
+		waiting,	/* the other set has output from the next block */
+		fading,		/* crossfading from the active set */
+	};
+
+	std::array<control_port, splits> f;
+	control_port order;
+	control_warning order_invalid;
+	LADSPA_Data *latency = nullptr;
+	std::array<LADSPA_Data *, channels> in = {};
+	std::array<std::array<LADSPA_Data *, N>, channels> out = {};
+	LADSPA_Data adding_gain = 1;
+	unsigned long fs = 0;
+
+	size_t taps = 0;
+	size_t delay = 0;		/* in samples */
+	std::unique_ptr<convolution_bank> bank;
+	std::vector<delay_line> lines;
+	idle_tracker idle;
+
+	/* filter sets, 'wanted' is latched from the controls and 'designed'
+	 * is in, or on its way to, the bank */
+	settings wanted, designed;
+	unsigned active = 0;
+	stage st = stage::settled;
+	size_t wait = 0;		/* samples until the other set has output */
+	ramp fade;			/* from the active set to the other */
+
+	/* design worker, 'request' is handed over by bumping 'submitted' */
+	settings request;
+	unsigned request_set = 0;
+	std::atomic<uint64_t> submitted{0}, done{0};
+	std::atomic<bool> stop{false};
+	std::thread worker;
+
+	/* filter design, used by the worker or by activate() while it is
+	 * idle */
+	std::unique_ptr<fft> design_fft;
+	std::vector<float> re, im, rest, h, window;
+
+	/* input, bands of the active set and bands of the other set */
+	alignas(32) std::array<std::array<float, block>, channels> x;
+	alignas(32) std::array<std::array<std::array<float, block>, N>,
+			       channels> y;
+	alignas(32) std::array<std::array<std::array<float, block>, splits>,
+			       channels> z;
+
+	~filter()
+	{
+		if (!worker.joinable())
+			return;
+		stop.store(true, std::memory_order_release);
+		submitted.fetch_add(1, std::memory_order_release);
+		submitted.notify_one();
+		worker.join();
+	}
+};
+
+template<size_t N>
+void work(filter<N> *);
+
+template<size_t N>
+LADSPA_Handle
+instantiate(const LADSPA_Descriptor *d, unsigned long fs)
+{
+	using std::numbers::pi;
+
+	auto p = new filter<N>;
+	p->fs = fs;
+	p->idle.init(d);
+	p->taps = std::bit_ceil(fs / 3);
+	const auto partition = partition_from_env();
+	p->delay = p->taps / 2 + partition;
+
+	const auto n = (idle_port(d) - filter<N>::control) / (N + 1);
+	p->bank = std::make_unique<convolution_bank>(n, 2 * filter<N>::splits,
+						     p->taps, partition);
+	for (size_t k = 0; k < filter<N>::splits; ++k)
+		p->bank->enable(filter<N>::splits + k, false);
+	p->lines.reserve(n);
+	for (size_t c = 0; c < n; ++c) {
+		p->lines.emplace_back(p->delay);
+		p->lines.back().resize(p->delay);
+	}
+
+	p->design_fft = std::make_unique<fft>(p->taps);
+	p->re.resize(p->taps / 2);
+	p->im.resize(p->taps / 2);
+	p->rest.resize(p->taps / 2 + 1);
+	p->h.resize(p->taps);
+	/* periodic Blackman window, exactly 1 at the centre tap */
+	p->window.resize(p->taps);
+	for (size_t i = 0; i < p->taps; ++i) {
+		const auto t = 2 * pi * i / p->taps;
+		p->window[i] = 0.42 - 0.5 * std::cos(t) + 0.08 * std::cos(2 * t);
+	}
+	p->worker = std::thread{work<N>, p};
+	return p;
+}
+
+template<size_t N>
+void
+connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+
+	if (p->idle.connect(port, d))
+		return;
+	if (port < filter<N>::splits)
+		return p->f[port].connect(d);
+	if (port == filter<N>::splits)
+		return p->order.connect(d);
+	if (port == filter<N>::splits + 1) {
+		p->latency = d;
+		return;
+	}
+	port -= filter<N>::control;
+	if (port >= (N + 1) * channels)
+		return;
+	auto ch = port / (N + 1);
+	auto i = port % (N + 1);
+	if (i == 0)
+		p->in[ch] = d;
+	else
+		p->out[ch][i - 1] = d;
+}
+
+/*
+ * design - compute band filters for settings 's' into filter set 'set'
+ *
+ * 'rest' is the magnitude left for the bands above split k, the product of
+ * the highpass magnitudes of the splits below it.
+ */
+template<size_t N>
+void
+design(filter<N> *p, const typename filter<N>::settings &s, unsigned set)
+{
+	const auto taps = p->taps;
+	const auto bins = taps / 2;
+
+	std::fill(begin(p->rest), end(p->rest), 1.0f);
+	for (size_t k = 0; k < filter<N>::splits; ++k) {
+		/* bin 'bins' is Nyquist, packed into im[0] */
+		for (size_t i = 0; i <= bins; ++i) {
+			const auto r = std::pow(i * double(p->fs) / taps /
+						s.f[k], double(s.order));
+			const auto band = p->rest[i] / (1 + r);
+			p->rest[i] *= r / (1 + r);
+			(i < bins ? p->re[i] : p->im[0]) = band;
+		}
+		std::fill(begin(p->im) + 1, end(p->im), 0.0f);
+
+		/* centre the zero phase response, window and normalise */
+		p->design_fft->inverse(data(p->re), data(p->im), data(p->h));
+		std::rotate(begin(p->h), begin(p->h) + bins, end(p->h));
+		for (size_t i = 0; i < taps; ++i)
+			p->h[i] *= p->window[i] / taps;
+		p->bank->set(set * filter<N>::splits + k, data(p->h));
+	}
+}
+
+/*
+ * work - design worker thread
+ *
+ * Runs with subnormals flushed to zero as plugins do in run().
+ */
+template<size_t N>
+void
+work(filter<N> *p)
+{
+	denormals_off guard;
+	for (;;) {
+		const auto next = p->done.load(std::memory_order_relaxed);
+		while (p->submitted.load(std::memory_order_acquire) == next)
+			p->submitted.wait(next, std::memory_order_acquire);
+		if (p->stop.load(std::memory_order_acquire))
+			return;
+
+		design(p, p->request, p->request_set);
+		p->done.store(next + 1, std::memory_order_release);
+		p->done.notify_one();
+	}
+}
+
+/*
+ * update - latch the design settings if controls changed
+ */
+template<size_t N>
+void
+update(filter<N> *p)
+{
+	for (size_t k = 0; k < filter<N>::splits; ++k) {
+		if (!p->f[k].update())
+			continue;
+		const LADSPA_Data f = p->f[k];
+		p->wanted.f[k] = std::isnan(f) ? 1 : std::max<LADSPA_Data>(f, 1);
+	}
+	if (p->order.update()) {
+		/* convert only values in range, NaN compares false */
+		const LADSPA_Data value = p->order;
+		unsigned order = value >= 0 && value <= 8 ? value : 0;
+		if (order < 2 || order > 8 || order % 2) {
+			p->order_invalid.raise();
+			order = 4;
+		}
+		p->wanted.order = order;
+	}
+}
+
+/*
+ * switch_sets - make the other set of filters the active one
+ */
+template<size_t N>
+void
+switch_sets(filter<N> *p)
+{
+	for (size_t k = 0; k < filter<N>::splits; ++k)
+		p->bank->enable(p->active * filter<N>::splits + k, false);
+	p->active ^= 1;
+	p->fade.finish();
+	p->st = filter<N>::stage::settled;
+}
+
+/*
+ * progress - start designing new settings, or put a finished design to use
+ */
+template<size_t N>
+void
+progress(filter<N> *p)
+{
+	using stage = typename filter<N>::stage;
+
+	switch (p->st) {
+	case stage::settled:
+		if (p->wanted == p->designed)
+			return;
+		p->designed = p->request = p->wanted;
+		p->request_set = p->active ^ 1;
+		p->submitted.fetch_add(1, std::memory_order_release);
+		p->submitted.notify_one();
+		p->st = stage::designing;
+		return;
+	case stage::designing:
+		if (p->done.load(std::memory_order_acquire) !=
+		    p->submitted.load(std::memory_order_relaxed))
+			return;
+		for (size_t k = 0; k < filter<N>::splits; ++k)
+			p->bank->enable((p->active ^ 1) * filter<N>::splits + k,
+					true);
+		p->wait = p->bank->remaining();
+		p->st = stage::waiting;
+		return;
+	default:
+		return;
+	}
+}
+
+/*
+ * report - print warnings about controls corrected since the last report
+ */
+template<size_t N>
+void
+report(filter<N> *p)
+{
+	p->order_invalid.report("WARNING: Linkwitz Riley crossover must be 2nd, 4th, 6th or 8th order. Defaulting to 4th order.\n");
+}
+
+template<size_t N>
+void
+activate(LADSPA_Handle h)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	update(p);
+	report(p);
+
+	/* let the worker finish, then design the settings straight into the
+	 * active set */
+	uint64_t d;
+	while ((d = p->done.load(std::memory_order_acquire)) !=
+	       p->submitted.load(std::memory_order_relaxed))
+		p->done.wait(d, std::memory_order_acquire);
+	for (size_t k = 0; k < filter<N>::splits; ++k)
+		p->bank->enable((p->active ^ 1) * filter<N>::splits + k,
+				false);
+	p->designed = p->wanted;
+	design(p, p->designed, p->active);
+	p->fade.finish();
+	p->st = filter<N>::stage::settled;
+
+	p->bank->reset();
+	for (auto &l : p->lines)
+		l.clear();
+	p->idle.reset();
+}
+
+template<size_t N>
+void
+deactivate(LADSPA_Handle h)
+{
+	report(reinterpret_cast<filter<N> *>(h));
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<size_t N, typename S>
+void
+process(filter<N> *p, unsigned long samples, S store)
+{
+	using stage = typename filter<N>::stage;
+	constexpr auto splits = filter<N>::splits;
+
+	denormals_off guard;
+	update(p);
+	progress(p);
+	if (p->latency)
+		*p->latency = p->delay;
+
+	/* stop on the first channel which is not fully connected */
+	size_t n = 0;
+	for (; n < size(p->lines); ++n)
+		if (!p->in[n] || std::count(begin(p->out[n]), end(p->out[n]),
+					    nullptr))
+			break;
+
+	/* store silence once the filters have rung out, skipping runs leaves
+	 * the bank and lines as if they had been given silence, so a new set
+	 * of filters can be switched to at once */
+	const auto tail = p->delay + p->taps / 2;
+	if (p->idle.set(p->idle.quiet(data(p->in), n, samples, tail),
+			samples)) {
+		if (p->st == stage::waiting || p->st == stage::fading)
+			switch_sets(p);
+		for (size_t c = 0; c < n; ++c)
+			for (auto out : p->out[c])
+				store_silence(p->in[c], out, samples, store);
+		return;
+	}
+
+	std::array<const float *, channels> x;
+	std::array<float *, channels * 2 * splits> y;
+	for (size_t c = 0; c < n; ++c)
+		x[c] = data(p->x[c]);
+
+	for (unsigned long i = 0, len; i < samples; i += len) {
+		len = std::min<unsigned long>(samples - i, block);
+		if (p->st == stage::waiting)
+			len = std::min<unsigned long>(len, p->wait);
+		if (p->st == stage::fading)
+			len = std::min<unsigned long>(len,
+						      p->fade.remaining());
+
+		/* bands of the active set go to y and of the other set to z */
+		for (size_t c = 0; c < n; ++c) {
+			auto o = &y[c * 2 * splits];
+			for (size_t b = 0; b < splits; ++b) {
+				o[p->active * splits + b] = data(p->y[c][b]);
+				o[(p->active ^ 1) * splits + b] =
+					data(p->z[c][b]);
+			}
+		}
+
+		/* all inputs are copied before any output is written */
+		for (size_t c = 0; c < n; ++c)
+			memcpy(p->x[c].data(), p->in[c] + i, len * sizeof(float));
+
+		p->bank->run(data(x), data(y), n, len);
+		const LADSPA_Data t0 = p->fade.value();
+		const LADSPA_Data step = p->fade.step();
+		for (size_t c = 0; c < n; ++c) {
+			auto &band = p->y[c];
+			if (p->st == stage::fading)
+				for (size_t b = 0; b < N - 1; ++b)
+					for (size_t j = 0; j < len; ++j)
+						band[b][j] += (p->z[c][b][j] -
+							       band[b][j]) *
+							      (t0 + step * (j + 1));
+			p->lines[c].run(x[c], data(band[N - 1]), p->delay, len);
+			for (size_t b = 0; b < N - 1; ++b)
+				for (size_t j = 0; j < len; ++j)
+					band[N - 1][j] -= band[b][j];
+			for (size_t b = 0; b < N; ++b)
+				store.block(p->out[c][b] + i, data(band[b]), len);
+		}
+
+		/* the other set has output from the end of the bank's block */
+		if (p->st == stage::waiting && !(p->wait -= len)) {
+			p->fade.jump(0);
+			p->fade.set(1, p->fs * ramp_time);
+			p->st = stage::fading;
+		} else if (p->st == stage::fading) {
+			p->fade.advance(len);
+			if (p->fade.settled())
+				switch_sets(p);
+		}
+	}
+}
+
+template<size_t N>
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	process(p, samples, replace{});
+}
+
+template<size_t N>
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+template<size_t N>
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	p->adding_gain = gain;
+}
+
+template<size_t N>
+void
+cleanup(LADSPA_Handle h)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	delete p;
+}
+
+/*
+ * band_names - output names for a crossover with N bands
+ */
+template<size_t N>
+constexpr std::array<const char *, N> band_names();
+
+template<>
+constexpr std::array<const char *, 2> band_names<2>()
+{
+	return {"Low", "High"};
+}
+
+template<>
+constexpr std::array<const char *, 3> band_names<3>()
+{
+	return {"Low", "Mid", "High"};
+}
+
+template<>
+constexpr std::array<const char *, 4> band_names<4>()
+{
+	return {"Low", "Low Mid", "High Mid", "High"};
+}
+
+/*
+ * register_crossover - register instances of a crossover with N bands
+ *
+ * Port layout is the controls of crossover_Nway, the latency output, then
+ * the input and the band outputs of each channel in turn.
+ */
+template<size_t N>
+void
+register_crossover(int id)
+{
+	constexpr auto splits = filter<N>::splits;
+	constexpr auto control = filter<N>::control;
+	constexpr auto count = control + (N + 1) * channels;
+
+	/* descriptors keep pointers to these */
+	static std::array<LADSPA_PortDescriptor, count> ports;
+	static std::array<std::string, count> names;
+	static std::array<const char *, count> port_names;
+	static std::array<LADSPA_PortRangeHint, count> port_hints;
+
+	for (size_t k = 0; k < splits; ++k) {
+		ports[k] = LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT;
+		names[k] = splits > 1
+		    ? "Crossover Frequency " + std::to_string(k + 1) + " (Hz)"
+		    : "Crossover Frequency (Hz)";
+		/* default to splits spread evenly in octaves */
+		port_hints[k] = {
+			.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+					  LADSPA_HINT_BOUNDED_ABOVE |
+					  LADSPA_HINT_SAMPLE_RATE |
+					  LADSPA_HINT_LOGARITHMIC,
+			.LowerBound = 0.0005,
+			.UpperBound = 0.45,
+		};
+		switch (splits > 1 ? k * 2 / (splits - 1) : 1) {
+		case 0:
+			port_hints[k].HintDescriptor |= LADSPA_HINT_DEFAULT_LOW;
+			break;
+		case 1:
+			port_hints[k].HintDescriptor |= LADSPA_HINT_DEFAULT_MIDDLE;
+			break;
+		default:
+			port_hints[k].HintDescriptor |= LADSPA_HINT_DEFAULT_HIGH;
+			break;
+		}
+	}
+	ports[splits] = LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT;
+	names[splits] = "Order";
+	port_hints[splits] = {
+		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+				  LADSPA_HINT_BOUNDED_ABOVE |
+				  LADSPA_HINT_LOGARITHMIC |
+				  LADSPA_HINT_DEFAULT_MIDDLE,
+		.LowerBound = 2,
+		.UpperBound = 8,
+	};
+	/* hosts report latency from an output control port named "latency" */
+	ports[splits + 1] = LADSPA_PORT_CONTROL | LADSPA_PORT_OUTPUT;
+	names[splits + 1] = "latency";
+	for (size_t c = 0; c < channels; ++c) {
+		auto ch = "Channel " + std::to_string(c + 1);
+		auto p = control + c * (N + 1);
+		ports[p] = LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT;
+		names[p] = ch + " Input";
+		for (size_t b = 0; b < N; ++b) {
+			ports[p + b + 1] = LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT;
+			names[p + b + 1] = ch + " " + band_names<N>()[b] + " Output";
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+		port_names[i] = names[i].c_str();
+
+	LADSPA_Descriptor d = {
+		.UniqueID = 0,
+		.Label = nullptr,
+		.Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+		.Name = nullptr,
+		.Maker = "Patrick Oppenlander <patrick.oppenlander@gmail.com>",
+		.Copyright = "Patrick Oppenlander, 2021",
+		.PortCount = 0,
+		.PortDescriptors = data(ports),
+		.PortNames = data(port_names),
+		.PortRangeHints = data(port_hints),
+		.ImplementationData = nullptr,
+		.instantiate = instantiate<N>,
+		.connect_port = connect_port<N>,
+		.activate = activate<N>,
+		.run = run<N>,
+		.run_adding = run_adding<N>,
+		.set_run_adding_gain = set_run_adding_gain<N>,
+		.deactivate = deactivate<N>,
+		.cleanup = cleanup<N>,
+	};
+
+	auto ways = std::to_string(N) + "way";
+	for (int i = 0; i < channels; ++i) {
+		d.UniqueID = id + i;
+		d.PortCount = control + (i + 1) * (N + 1);
+		register_plugin({d,
+		    "linear_phase_crossover_" + ways + "_" +
+		    std::to_string(i + 1) + "ch",
+		    "Linear Phase Crossover (" + std::to_string(N) +
+		    " Way, " + std::to_string(i + 1) + " Channel)"});
+	}
+}
+
+/*
+ * register plugin instances
+ */
+struct init {
+	init()
+	{
+		register_crossover<2>(ladspa_ids::linear_phase_crossover_2way);
+		register_crossover<3>(ladspa_ids::linear_phase_crossover_3way);
+		register_crossover<4>(ladspa_ids::linear_phase_crossover_4way);
+	}
+} init;
+
+} /* namespace */
@@ -1,6 +1,12 @@
 #include "biquad.h"
+#include "coefficient_cache.h"
+#include "control.h"
+#include "denormal.h"
 #include "descriptor.h"
+#include "idle.h"
+#include "io.h"
 #include "ladspa_ids.h"
+#include "smooth.h"
 #include <array>
 #include <cmath>
 
@@ -10,12 +16,18 @@ constexpr auto control = 2;
 constexpr auto channels = 8;
 
 struct filter {
-	LADSPA_Data f0 = 0;
-	unsigned order = 0;
+	control_port f0, order;
+	control_warning order_invalid;
+	ramp log_f0;
+	unsigned filter_order = 2;
+	unsigned sections = 1;
 	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
 	unsigned long fs = 0;
-	biquad_coefficients bqc;
-	std::array<std::array<biquad, 2>, channels> bq;
+	std::array<biquad_coefficients, 8> bqc;
+	const std::array<biquad_coefficients, 8> *coeffs = &bqc;
+	biquad_cascade<8> bq;
+	idle_tracker idle;
 };
 
 LADSPA_Handle
@@ -23,6 +35,9 @@ instantiate(const LADSPA_Descriptor *d, unsigned long fs)
 {
 	auto p = new filter;
 	p->fs = fs;
+	p->idle.init(d);
+	p->bq.set_kernel(biquad_kernel_from_env());
+	p->bq.set_precision(biquad_precision_from_env());
 	return p;
 }
 
@@ -31,20 +46,15 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 {
 	filter *p = reinterpret_cast<filter *>(h);
 
+	if (p->idle.connect(port, d))
+		return;
 	switch (port) {
 	case 0:
-		p->f0 = *d;
+		p->f0.connect(d);
 		return;
 	case 1:
-		p->order = *d;
-		switch (p->order) {
-		case 2:
-		case 4:
-			break;
-		default:
-			fprintf(stderr, "WARNING: Linkwitz Riley filter must be 2nd or 4th order. Defaulting to 2nd order.\n");
-			p->order = 2;
-		}
+		p->order.connect(d);
+		return;
 	}
 	port -= control;
 	if (port >= 2 * channels)
@@ -52,19 +62,163 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 	p->io[port / 2][port % 2] = d;
 }
 
+/*
+ * key - cache key for the current ramp value and order
+ */
+coefficient_key
+key(const filter *p)
+{
+	return {
+		.type = coefficient_key::filter::linkwitz_riley_highpass,
+		.f0 = std::exp(p->log_f0.value()),
+		.order = p->filter_order,
+		.fs = p->fs,
+	};
+}
+
+/*
+ * compute - compute coefficients for the current ramp value
+ */
+void
+compute(const filter *p, std::array<biquad_coefficients, 8> &c,
+	biquad_design d)
+{
+	auto f0 = std::exp(p->log_f0.value());
+
+	linkwitz_riley_highpass(data(c), p->filter_order, f0, p->fs, d);
+}
+
+/*
+ * design - select coefficients for the current ramp value
+ *
+ * Settled designs are shared with other instances if they have already been
+ * cached by activate().
+ */
+void
+design(filter *p, biquad_design d = biquad_design::exact)
+{
+	if (d == biquad_design::exact &&
+	    (p->coeffs = coefficient_cache<8>::find(key(p))))
+		return;
+	compute(p, p->bqc, d);
+	p->coeffs = &p->bqc;
+}
+
+/*
+ * resize - change the number of sections
+ *
+ * Sections are inserted after the others, where their input has already
+ * been filtered, and erased from the front, so that the output carries on
+ * from its own history rather than from the state of sections which were not
+ * running.
+ */
+void
+resize(filter *p, unsigned sections)
+{
+	for (; p->sections < sections; ++p->sections)
+		for (size_t ch = 0; ch < channels; ++ch)
+			p->bq.insert(p->sections, ch);
+	for (; p->sections > sections; --p->sections)
+		for (size_t ch = 0; ch < channels; ++ch)
+			p->bq.erase(0, ch);
+}
+
+/*
+ * update - retarget the frequency ramp or change order if controls changed
+ */
+void
+update(filter *p)
+{
+	auto changed = false;
+	if (p->f0.update()) {
+		/* frequency ramps in octaves rather than hertz */
+		p->log_f0.set(std::log(std::max<double>(p->f0, 1)),
+			      p->fs * ramp_time);
+		changed = true;
+	}
+	if (p->order.update()) {
+		/* convert only values in range, NaN compares false */
+		const LADSPA_Data value = p->order;
+		unsigned order = value >= 0 && value <= 16 ? value : 0;
+		if (order < 2 || order > 16 || order % 2) {
+			p->order_invalid.raise();
+			order = 2;
+		}
+		p->filter_order = order;
+		/* a section per pole pair */
+		resize(p, order / 2);
+		changed = true;
+	}
+
+	/* a ramping frequency is designed block by block in run() */
+	if (changed && p->log_f0.settled())
+		design(p);
+}
+
+/*
+ * report - print warnings about controls corrected since the last report
+ */
+void
+report(filter *p)
+{
+	p->order_invalid.report("WARNING: Linkwitz Riley filter must be of even order from 2 to 16. Defaulting to 2nd order.\n");
+}
+
 void
 activate(LADSPA_Handle h)
 {
 	filter *p = reinterpret_cast<filter *>(h);
+	update(p);
+	report(p);
+	p->idle.reset();
+	p->log_f0.finish();
+	p->coeffs = coefficient_cache<8>::insert(key(p), [p](auto &c) {
+		compute(p, c, biquad_design::exact);
+	});
+	if (!p->coeffs)
+		design(p);
+}
+
+void
+deactivate(LADSPA_Handle h)
+{
+	report(reinterpret_cast<filter *>(h));
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
 
-	/* see https://www.linkwitzlab.com/filters.htm */
-	switch (p->order) {
-	case 2:
-		p->bqc.hpf(p->f0, 0.5, p->fs);
-		break;
-	case 4:
-		p->bqc.hpf(p->f0, std::cos(std::numbers::pi / 4.0), p->fs);
-		break;
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence while silence goes in and the filter has decayed */
+	const auto idle = p->idle.quiet(data(in), n, samples) &&
+			  p->log_f0.settled() &&
+			  p->bq.quiet(p->sections, silence);
+	if (p->idle.set(idle, samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+
+	for (unsigned long i = 0, len; i < samples; i += len) {
+		len = samples - i;
+		if (!p->log_f0.settled()) {
+			len = std::min<unsigned long>(len, ramp_block);
+			p->log_f0.advance(len);
+			/* approximate while moving, exact once settled */
+			design(p, p->log_f0.settled() ? biquad_design::exact
+						      : biquad_design::fast);
+		}
+		p->bq.run(*p->coeffs, p->sections, data(in), data(out), n, len, store);
+		advance_channels(in, out, n, len);
 	}
 }
 
@@ -72,17 +226,21 @@ void
 run(LADSPA_Handle h, unsigned long samples)
 {
 	filter *p = reinterpret_cast<filter *>(h);
-	for (auto i = 0; i < channels; ++i) {
-		/* stop on first unconnected port */
-		if (!p->io[i][0] || !p->io[i][1])
-			return;
-		/* second order */
-		p->bq[i][0].run(p->bqc, p->io[i][0], p->io[i][1], samples);
-
-		/* fourth order */
-		if (p->order > 2)
-			p->bq[i][1].run(p->bqc, p->io[i][1], p->io[i][1], samples);
-	}
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
 }
 
 void
@@ -142,9 +300,9 @@ constexpr std::array<LADSPA_PortRangeHint, size(ports)> port_hints = { { {
 	}, {
 		.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
 				  LADSPA_HINT_BOUNDED_ABOVE |
-				  LADSPA_HINT_DEFAULT_MIDDLE,
+				  LADSPA_HINT_DEFAULT_MINIMUM,
 		.LowerBound = 2,
-		.UpperBound = 4,
+		.UpperBound = 16,
 	}
 } };
 
@@ -170,9 +328,9 @@ struct init {
 			.connect_port = connect_port,
 			.activate = activate,
 			.run = run,
-			.run_adding = nullptr,
-			.set_run_adding_gain = nullptr,
-			.deactivate = nullptr,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
+			.deactivate = deactivate,
 			.cleanup = cleanup,
 		};
 
@@ -0,0 +1,260 @@
+#include "nonuniform_convolution.h"
+
+#include "denormal.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr size_t min_tail_ratio = 8;	/* smallest T in head partitions */
+constexpr size_t max_tail_size = 16384;
+
+/*
+ * tail_size - tail partition size for an impulse response of 'length' taps
+ *
+ * Per sample the head costs about 2T / B complex products and the tail about
+ * length / T, which balance at T = sqrt(length * B / 2). Returns 0 if the
+ * head alone covers the impulse response.
+ */
+size_t
+tail_size(size_t length, size_t partition)
+{
+	auto t = std::bit_ceil(static_cast<size_t>(
+	    std::sqrt(length * partition / 2.0)));
+	t = std::clamp(t, min_tail_ratio * partition,
+		       std::max(min_tail_ratio * partition, max_tail_size));
+	return length > 2 * t ? t : 0;
+}
+
+/* the tail is added to whatever the head stored */
+accumulate
+adding(replace)
+{
+	return {1};
+}
+
+accumulate
+adding(accumulate a)
+{
+	return a;
+}
+
+}
+
+/*
+ * nonuniform_convolution
+ */
+nonuniform_convolution::nonuniform_convolution(
+    const std::vector<std::span<const float>> &ir, size_t partition)
+: size_{partition}
+, tail_size_{0}
+{
+	size_t length = 0;
+	for (auto h : ir)
+		length = std::max(length, size(h));
+	tail_size_ = tail_size(length, size_);
+
+	const auto head = tail_size_ ? 2 * tail_size_ : length;
+	head_.reserve(size(ir));
+	for (auto h : ir)
+		head_.emplace_back(data(h), std::min(head, size(h)), size_);
+	if (!tail_size_)
+		return;
+
+	tail_.reserve(size(ir));
+	for (auto h : ir) {
+		const auto n = size(h) - std::min(head, size(h));
+		tail_.emplace_back(data(h) + size(h) - n, n, tail_size_);
+	}
+	tail_in_.resize(slots * size(ir) * tail_size_);
+	tail_out_.resize(slots * size(ir) * tail_size_);
+	worker_ = std::thread{&nonuniform_convolution::work, this};
+}
+
+/*
+ * ~nonuniform_convolution
+ */
+nonuniform_convolution::~nonuniform_convolution()
+{
+	if (!worker_.joinable())
+		return;
+	stop_.store(true, std::memory_order_release);
+	submitted_.fetch_add(1, std::memory_order_release);
+	submitted_.notify_one();
+	worker_.join();
+}
+
+/*
+ * nonuniform_convolution::reset
+ */
+void
+nonuniform_convolution::reset()
+{
+	/* let the worker finish whatever it has been given */
+	uint64_t d;
+	while ((d = done_.load(std::memory_order_acquire)) !=
+	       submitted_.load(std::memory_order_relaxed))
+		done_.wait(d, std::memory_order_acquire);
+
+	for (auto &c : head_)
+		c.reset();
+	for (auto &c : tail_)
+		c.reset();
+	base_ = d;
+	pos_ = 0;
+	misses_ = 0;
+}
+
+/*
+ * nonuniform_convolution::run
+ *
+ * Works in chunks which end at every boundary of the input blocks handed to
+ * the worker and of the output blocks picked up from it. The tail output for
+ * sample n is the worker's result for sample n - B - 2T, so the worker has
+ * T + B samples from handoff to deadline.
+ */
+template<typename S>
+void
+nonuniform_convolution::run(const float *const *input, float *const *output,
+			    size_t channels, size_t samples, S store)
+{
+	channels = std::min(channels, size(head_));
+	if (!tail_size_) {
+		for (size_t c = 0; c < channels; ++c)
+			head_[c].run(input[c], output[c], samples, store);
+		return;
+	}
+
+	const auto t = tail_size_;
+	const auto delay = size_ + 2 * t;
+	for (size_t i = 0; i < samples;) {
+		auto n = std::min(samples - i, t - pos_ % t);
+		if (pos_ < delay)
+			n = std::min<size_t>(n, delay - pos_);
+		else
+			n = std::min(n, t - (pos_ - delay) % t);
+
+		/* take a copy for the tail before the head can overwrite the
+		 * input in place */
+		for (size_t c = 0; c < channels; ++c)
+			memcpy(slot(tail_in_, pos_ / t, c) + pos_ % t,
+			       input[c] + i, n * sizeof(float));
+		for (size_t c = 0; c < channels; ++c)
+			head_[c].run(input[c] + i, output[c] + i, n, store);
+
+		if (pos_ >= delay) {
+			const auto m = pos_ - delay;
+			await(m / t);
+			for (size_t c = 0; c < channels; ++c)
+				adding(store).block(output[c] + i,
+				    slot(tail_out_, m / t, c) + m % t, n);
+		}
+
+		pos_ += n;
+		i += n;
+		if (pos_ % t == 0)
+			submit(pos_ / t - 1);
+	}
+}
+
+/*
+ * nonuniform_convolution::latency
+ */
+size_t
+nonuniform_convolution::latency() const
+{
+	return size_;
+}
+
+/*
+ * nonuniform_convolution::tail_partition
+ */
+size_t
+nonuniform_convolution::tail_partition() const
+{
+	return tail_size_;
+}
+
+/*
+ * nonuniform_convolution::misses
+ */
+size_t
+nonuniform_convolution::misses() const
+{
+	return misses_;
+}
+
+/*
+ * nonuniform_convolution::slot - tail buffer of a channel for a block since
+ * reset
+ */
+float *
+nonuniform_convolution::slot(std::vector<float> &v, uint64_t block,
+			     size_t channel)
+{
+	const auto s = (base_ + block) % slots;
+	return &v[(s * size(tail_) + channel) * tail_size_];
+}
+
+/*
+ * nonuniform_convolution::submit - hand a complete input block to the worker
+ */
+void
+nonuniform_convolution::submit(uint64_t block)
+{
+	submitted_.store(base_ + block + 1, std::memory_order_release);
+	submitted_.notify_one();
+}
+
+/*
+ * nonuniform_convolution::await - wait for the worker to complete a block
+ *
+ * Input for a block is written to the same slot three blocks later, after
+ * this has returned for it, so run() never overwrites a slot in use.
+ */
+void
+nonuniform_convolution::await(uint64_t block)
+{
+	const auto want = base_ + block + 1;
+	auto d = done_.load(std::memory_order_acquire);
+	if (d >= want)
+		return;
+	++misses_;
+	for (; d < want; d = done_.load(std::memory_order_acquire))
+		done_.wait(d, std::memory_order_acquire);
+}
+
+/*
+ * nonuniform_convolution::work - worker thread
+ *
+ * Runs with subnormals flushed to zero as plugins do in run().
+ */
+void
+nonuniform_convolution::work()
+{
+	denormals_off guard;
+	for (;;) {
+		const auto next = done_.load(std::memory_order_relaxed);
+		while (submitted_.load(std::memory_order_acquire) == next)
+			submitted_.wait(next, std::memory_order_acquire);
+		if (stop_.load(std::memory_order_acquire))
+			return;
+
+		const auto s = next % slots;
+		for (size_t c = 0; c < size(tail_); ++c) {
+			const auto o = (s * size(tail_) + c) * tail_size_;
+			tail_[c].block(&tail_in_[o], &tail_out_[o]);
+		}
+		done_.store(next + 1, std::memory_order_release);
+		done_.notify_one();
+	}
+}
+
+template void nonuniform_convolution::run(const float *const *,
+					  float *const *, size_t, size_t,
+					  replace);
+template void nonuniform_convolution::run(const float *const *,
+					  float *const *, size_t, size_t,
+					  accumulate);
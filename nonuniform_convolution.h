@@ -0,0 +1,78 @@
+#pragma once
+
+#include "partitioned_convolution.h"
+#include "store.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+/*
+ * nonuniform_convolution - two level partitioned convolution of several
+ * channels with a background worker
+ *
+ * The first 2T taps of each impulse response, the head, are convolved in
+ * run() with partitions of 'partition' samples, B. The rest, the tail, is
+ * convolved with partitions of T samples by a worker thread shared by all
+ * channels. T is chosen from the impulse response length to balance the cost
+ * of the two levels, so long impulse responses run at small B for a fraction
+ * of the cost of uniform partitions.
+ *
+ * run() hands each complete block of T input samples to the worker through a
+ * ring of three slots and picks up the result T + B samples later, which is
+ * the worker's deadline. Handoff is lock free. If the worker is late run()
+ * waits for it so that output is always exact, and counts a miss.
+ *
+ * Output is delayed by B samples. Short impulse responses are convolved in
+ * run() alone without starting a worker. All memory is allocated and the
+ * worker started by the constructor, so reset() and run() are real time safe
+ * as long as the worker meets its deadlines. As it may not, run() is not hard
+ * real time capable once there is a tail.
+ */
+class nonuniform_convolution {
+public:
+	/* 'partition' must be a power of two, at least 2 */
+	nonuniform_convolution(const std::vector<std::span<const float>> &ir,
+			       size_t partition);
+	~nonuniform_convolution();
+
+	/* clear all input history, must not run concurrently with run() */
+	void reset();
+
+	/* input and output may point to the same place */
+	template<typename S = replace>
+	void run(const float *const *input, float *const *output,
+		 size_t channels, size_t samples, S = {});
+
+	/* delay of the output in samples */
+	size_t latency() const;
+
+	/* partition size of the tail, 0 if there is no tail */
+	size_t tail_partition() const;
+
+	/* times run() has waited for the worker since reset() */
+	size_t misses() const;
+
+private:
+	static constexpr size_t slots = 3;
+
+	float *slot(std::vector<float> &, uint64_t block, size_t channel);
+	void submit(uint64_t block);
+	void await(uint64_t block);
+	void work();
+
+	size_t size_;			/* head partition size, B */
+	size_t tail_size_;		/* tail partition size, T */
+	std::vector<partitioned_convolution> head_, tail_;
+	std::vector<float> tail_in_, tail_out_;	/* [slots][channels][T] */
+	uint64_t pos_ = 0;		/* samples since reset */
+	uint64_t base_ = 0;		/* blocks handed off before reset */
+	size_t misses_ = 0;
+
+	/* blocks handed to and completed by the worker */
+	std::atomic<uint64_t> submitted_{0}, done_{0};
+	std::atomic<bool> stop_{false};
+	std::thread worker_;
+};
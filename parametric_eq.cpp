@@ -0,0 +1,311 @@
+#include "biquad.h"
+#include "denormal.h"
+#include "descriptor.h"
+#include "eq_band.h"
+#include "idle.h"
+#include "io.h"
+#include "ladspa_ids.h"
+#include <array>
+#include <cmath>
+#include <string>
+
+namespace {
+
+constexpr auto channels = 8;
+
+/*
+ * filter - parametric equaliser with up to N bands
+ *
+ * Enabled bands are packed into a single cascade which pushes each sample
+ * through every section before storing it, so the whole equaliser reads and
+ * writes each buffer once. Bands which are off or settled at 0dB take no
+ * space in the cascade, and with no bands left the input is passed through.
+ */
+template<size_t N>
+struct filter {
+	static constexpr auto control = N * eq_band::controls;
+
+	std::array<eq_band, N> bands;
+	size_t sections = 0;
+	bool draining = false;
+	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
+	unsigned long fs = 0;
+	std::array<biquad_coefficients, N> bqc;
+	biquad_cascade<N> bq;
+	idle_tracker idle;
+};
+
+template<size_t N>
+LADSPA_Handle
+instantiate(const LADSPA_Descriptor *d, unsigned long fs)
+{
+	auto p = new filter<N>;
+	p->fs = fs;
+	p->idle.init(d);
+	p->bq.set_kernel(biquad_kernel_from_env());
+	p->bq.set_precision(biquad_precision_from_env());
+	return p;
+}
+
+template<size_t N>
+void
+connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+
+	if (p->idle.connect(port, d))
+		return;
+	if (port < filter<N>::control)
+		return p->bands[port / eq_band::controls].connect(
+		    port % eq_band::controls, d);
+	port -= filter<N>::control;
+	if (port >= 2 * channels)
+		return;
+	p->io[port / 2][port % 2] = d;
+}
+
+/*
+ * ramping - check if any band is moving towards new settings
+ */
+template<size_t N>
+bool
+ramping(const filter<N> *p)
+{
+	for (auto &b : p->bands)
+		if (b.ramping())
+			return true;
+	return false;
+}
+
+/*
+ * pack - pack and design the bands which change the signal
+ */
+template<size_t N>
+void
+pack(filter<N> *p)
+{
+	p->sections = pack_bands(p->bands, p->bqc, p->bq, 0, p->sections, 0,
+				 channels, p->fs, p->draining);
+}
+
+/*
+ * drain - remove the bands which have left the cascade once drained
+ */
+template<size_t N>
+void
+drain(filter<N> *p)
+{
+	p->sections = drain_bands(p->bands, p->bqc, p->bq, p->sections, 0,
+				  channels, p->draining);
+}
+
+/*
+ * update - retarget band ramps and repack bands if controls changed
+ */
+template<size_t N>
+void
+update(filter<N> *p)
+{
+	auto changed = false;
+	for (auto &b : p->bands) {
+		bool c;
+		b.update(p->fs, c);
+		changed |= c;
+	}
+	if (changed)
+		pack(p);
+}
+
+template<size_t N>
+void
+activate(LADSPA_Handle h)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	update(p);
+	for (auto &b : p->bands)
+		b.report();
+	p->idle.reset();
+	for (auto &b : p->bands)
+		b.finish();
+	pack(p);
+}
+
+template<size_t N>
+void
+deactivate(LADSPA_Handle h)
+{
+	for (auto &b : reinterpret_cast<filter<N> *>(h)->bands)
+		b.report();
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<size_t N, typename S>
+void
+process(filter<N> *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
+
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence while silence goes in and the filter has decayed */
+	const auto idle = p->idle.quiet(data(in), n, samples) &&
+			  !ramping(p) &&
+			  (!p->sections || p->bq.quiet(p->sections, silence));
+	if (p->idle.set(idle, samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+
+	for (unsigned long i = 0, len; i < samples; i += len) {
+		len = samples - i;
+		if (ramping(p)) {
+			len = std::min<unsigned long>(len, ramp_block);
+			auto settled = false;
+			for (auto &b : p->bands) {
+				if (!b.ramping())
+					continue;
+				b.advance(len);
+				settled |= !b.ramping();
+				/* approximate while moving, exact once settled */
+				b.design(p->bqc[b.section], p->fs,
+					 b.ramping() ? biquad_design::fast
+						     : biquad_design::exact);
+			}
+			if (settled)
+				pack(p);
+		}
+		/* bands which settled at 0dB or were switched off leave the
+		 * cascade once drained */
+		if (p->draining)
+			drain(p);
+		if (p->sections)
+			p->bq.run(p->bqc, p->sections, data(in), data(out), n,
+				  len, store);
+		else {
+			p->bq.skip(data(in), n, len);
+			for (size_t c = 0; c < n; ++c)
+				store.block(out[c], in[c], len);
+		}
+		advance_channels(in, out, n, len);
+	}
+}
+
+template<size_t N>
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	process(p, samples, replace{});
+}
+
+template<size_t N>
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+template<size_t N>
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	p->adding_gain = gain;
+}
+
+template<size_t N>
+void
+cleanup(LADSPA_Handle h)
+{
+	auto p = reinterpret_cast<filter<N> *>(h);
+	delete p;
+}
+
+/*
+ * register_parametric_eq - register instances of an equaliser with N bands
+ *
+ * Port layout is the type, frequency, gain & bandwidth of each band followed
+ * by the input and output of each channel in turn.
+ */
+template<size_t N>
+void
+register_parametric_eq(int id)
+{
+	constexpr auto control = filter<N>::control;
+	constexpr auto count = control + 2 * channels;
+
+	/* descriptors keep pointers to these */
+	static std::array<LADSPA_PortDescriptor, count> ports;
+	static std::array<std::string, count> names;
+	static std::array<const char *, count> port_names;
+	static std::array<LADSPA_PortRangeHint, count> port_hints;
+
+	for (size_t k = 0; k < N; ++k) {
+		auto p = k * eq_band::controls;
+		eq_band::describe("Band " + std::to_string(k + 1), &ports[p],
+				  &names[p], &port_hints[p]);
+	}
+	for (size_t c = 0; c < channels; ++c) {
+		auto ch = "Channel " + std::to_string(c + 1);
+		auto p = control + c * 2;
+		ports[p] = LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT;
+		names[p] = ch + " Input";
+		ports[p + 1] = LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT;
+		names[p + 1] = ch + " Output";
+	}
+	for (size_t i = 0; i < count; ++i)
+		port_names[i] = names[i].c_str();
+
+	LADSPA_Descriptor d = {
+		.UniqueID = 0,
+		.Label = nullptr,
+		.Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+		.Name = nullptr,
+		.Maker = "Patrick Oppenlander <patrick.oppenlander@gmail.com>",
+		.Copyright = "Patrick Oppenlander, 2021",
+		.PortCount = 0,
+		.PortDescriptors = data(ports),
+		.PortNames = data(port_names),
+		.PortRangeHints = data(port_hints),
+		.ImplementationData = nullptr,
+		.instantiate = instantiate<N>,
+		.connect_port = connect_port<N>,
+		.activate = activate<N>,
+		.run = run<N>,
+		.run_adding = run_adding<N>,
+		.set_run_adding_gain = set_run_adding_gain<N>,
+		.deactivate = deactivate<N>,
+		.cleanup = cleanup<N>,
+	};
+
+	auto bands = std::to_string(N) + "band";
+	for (int i = 0; i < channels; ++i) {
+		d.UniqueID = id + i;
+		d.PortCount = control + (i + 1) * 2;
+		register_plugin({d,
+		    "parametric_eq_" + bands + "_" + std::to_string(i + 1) + "ch",
+		    "Parametric EQ (" + std::to_string(N) + " Band, " +
+		    std::to_string(i + 1) + " Channel)"});
+	}
+}
+
+/*
+ * register plugin instances
+ */
+struct init {
+	init()
+	{
+		register_parametric_eq<4>(ladspa_ids::parametric_eq_4band);
+		register_parametric_eq<8>(ladspa_ids::parametric_eq_8band);
+		register_parametric_eq<16>(ladspa_ids::parametric_eq_16band);
+	}
+} init;
+
+} /* namespace */
@@ -0,0 +1,159 @@
+#include "partitioned_convolution.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr size_t default_partition = 256;
+constexpr size_t min_partition = 16;
+constexpr size_t max_partition = 8192;
+
+}
+
+/*
+ * partitioned_convolution
+ */
+partitioned_convolution::partitioned_convolution(const float *ir,
+						 size_t length,
+						 size_t partition)
+: size_{partition}
+, count_{std::max<size_t>(1, (length + partition - 1) / partition)}
+, fft_{2 * partition}
+, ir_re_(count_ * size_)
+, ir_im_(count_ * size_)
+, fdl_re_(count_ * size_)
+, fdl_im_(count_ * size_)
+, acc_re_(size_)
+, acc_im_(size_)
+, input_(2 * size_)
+, output_(2 * size_)
+{
+	/* each partition is zero padded to the transform size, and the scale
+	 * of the transforms is folded into the partition spectra */
+	std::vector<float> padded(2 * size_);
+	const auto scale = 1.0f / fft_.size();
+	for (size_t p = 0; p < count_; ++p) {
+		const auto start = std::min(p * size_, length);
+		const auto n = std::min(size_, length - start);
+		std::fill(begin(padded), end(padded), 0.0f);
+		std::transform(ir + start, ir + start + n, begin(padded),
+			       [scale](float v) { return v * scale; });
+		fft_.forward(data(padded), &ir_re_[p * size_],
+			     &ir_im_[p * size_]);
+	}
+}
+
+/*
+ * partitioned_convolution::reset
+ */
+void
+partitioned_convolution::reset()
+{
+	std::fill(begin(fdl_re_), end(fdl_re_), 0.0f);
+	std::fill(begin(fdl_im_), end(fdl_im_), 0.0f);
+	std::fill(begin(input_), end(input_), 0.0f);
+	std::fill(begin(output_), end(output_), 0.0f);
+	fdl_pos_ = 0;
+	fill_ = 0;
+}
+
+/*
+ * partitioned_convolution::run
+ *
+ * Each chunk of input is copied into the current block before the matching
+ * chunk of the previous block's output is stored, so in place processing is
+ * safe.
+ */
+template<typename S>
+void
+partitioned_convolution::run(const float *input, float *output,
+			     size_t samples, S store)
+{
+	while (samples) {
+		const auto n = std::min(samples, size_ - fill_);
+		memcpy(&input_[size_ + fill_], input, n * sizeof(float));
+		store.block(output, &output_[size_ + fill_], n);
+		fill_ += n;
+		input += n;
+		output += n;
+		samples -= n;
+		if (fill_ == size_)
+			process();
+	}
+}
+
+/*
+ * partitioned_convolution::process - convolve a complete block of input
+ */
+void
+partitioned_convolution::process()
+{
+	fdl_pos_ = fdl_pos_ ? fdl_pos_ - 1 : count_ - 1;
+	fft_.forward(data(input_), &fdl_re_[fdl_pos_ * size_],
+		     &fdl_im_[fdl_pos_ * size_]);
+
+	/* partition p multiplies the input spectrum from p blocks ago */
+	std::fill(begin(acc_re_), end(acc_re_), 0.0f);
+	std::fill(begin(acc_im_), end(acc_im_), 0.0f);
+	for (size_t p = 0, x = fdl_pos_; p < count_; ++p) {
+		fft::multiply_accumulate(data(acc_re_), data(acc_im_),
+					 &fdl_re_[x * size_],
+					 &fdl_im_[x * size_],
+					 &ir_re_[p * size_],
+					 &ir_im_[p * size_], size_);
+		if (++x == count_)
+			x = 0;
+	}
+
+	/* overlap-save, the second half of the result is the output */
+	fft_.inverse(data(acc_re_), data(acc_im_), data(output_));
+	memcpy(data(input_), &input_[size_], size_ * sizeof(float));
+	fill_ = 0;
+}
+
+/*
+ * partitioned_convolution::block
+ */
+void
+partitioned_convolution::block(const float *input, float *output)
+{
+	memcpy(&input_[size_], input, size_ * sizeof(float));
+	process();
+	memcpy(output, &output_[size_], size_ * sizeof(float));
+}
+
+/*
+ * partitioned_convolution::latency
+ */
+size_t
+partitioned_convolution::latency() const
+{
+	return size_;
+}
+
+/*
+ * partition_from_env - partition size selected by PO_CONVOLVER_PARTITION
+ */
+size_t
+partition_from_env()
+{
+	auto e = getenv("PO_CONVOLVER_PARTITION");
+	if (!e)
+		return default_partition;
+	const size_t v = strtoul(e, nullptr, 10);
+	if (!std::has_single_bit(v) || v < min_partition || v > max_partition) {
+		fprintf(stderr, "WARNING: Partition size must be a power of two from %zu to %zu. Using %zu.\n",
+			min_partition, max_partition, default_partition);
+		return default_partition;
+	}
+	return v;
+}
+
+template void partitioned_convolution::run(const float *, float *, size_t,
+					   replace);
+template void partitioned_convolution::run(const float *, float *, size_t,
+					   accumulate);
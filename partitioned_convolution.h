@@ -0,0 +1,61 @@
+#pragma once
+
+#include "fft.h"
+#include "store.h"
+#include <cstddef>
+#include <vector>
+
+/*
+ * partitioned_convolution - uniformly partitioned FFT convolution
+ *
+ * The impulse response is split into partitions of 'partition' samples which
+ * are transformed once up front. Input is collected into blocks of the same
+ * size, each block is transformed once and kept in a frequency domain delay
+ * line, and the output block is the sum of the products of every partition
+ * with the input spectrum delayed by the partition's position, transformed
+ * back with overlap-save.
+ *
+ * Output is delayed by 'partition' samples regardless of how run() is
+ * called. All memory is allocated by the constructor, so reset() and run()
+ * are real time safe. Output is written by the store policy S.
+ */
+class partitioned_convolution {
+public:
+	/* 'partition' must be a power of two, at least 2 */
+	partitioned_convolution(const float *ir, size_t length,
+				size_t partition);
+
+	/* clear all input history */
+	void reset();
+
+	/* input and output may point to the same place */
+	template<typename S = replace>
+	void run(const float *input, float *output, size_t samples, S = {});
+
+	/* convolve one whole partition with no buffering, for callers which
+	 * buffer input themselves: output is the result for the same samples
+	 * as input. Not to be mixed with run() without a reset() between. */
+	void block(const float *input, float *output);
+
+	/* delay of the output in samples */
+	size_t latency() const;
+
+private:
+	void process();
+
+	size_t size_;			/* partition size */
+	size_t count_;			/* number of partitions */
+	fft fft_;
+	std::vector<float> ir_re_, ir_im_;	/* partition spectra */
+	std::vector<float> fdl_re_, fdl_im_;	/* input spectra */
+	size_t fdl_pos_ = 0;			/* newest input spectrum */
+	std::vector<float> acc_re_, acc_im_;	/* output spectrum */
+	std::vector<float> input_;	/* last two input blocks */
+	std::vector<float> output_;	/* inverse transform */
+	size_t fill_ = 0;		/* samples in the current block */
+};
+
+/*
+ * partition_from_env - partition size selected by PO_CONVOLVER_PARTITION
+ */
+size_t partition_from_env();
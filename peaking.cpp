@@ -1,7 +1,14 @@
 #include "biquad.h"
+#include "coefficient_cache.h"
+#include "control.h"
+#include "denormal.h"
 #include "descriptor.h"
+#include "idle.h"
+#include "io.h"
 #include "ladspa_ids.h"
+#include "smooth.h"
 #include <array>
+#include <cmath>
 
 namespace {
 
@@ -9,11 +16,16 @@ constexpr auto control = 3;
 constexpr auto channels = 8;
 
 struct filter {
-	LADSPA_Data f0 = 0, gain = 0, Q = 0;
+	control_port f0, gain, Q;
+	ramp log_f0, gain_db, bandwidth;
 	std::array<std::array<LADSPA_Data *, 2>, channels> io = {};
+	LADSPA_Data adding_gain = 1;
 	unsigned long fs = 0;
-	biquad_coefficients bqc;
-	std::array<biquad, channels> bq;
+	std::array<biquad_coefficients, 1> bqc;
+	const std::array<biquad_coefficients, 1> *coeffs = &bqc;
+	bool passthrough = false;
+	biquad_cascade<1> bq;
+	idle_tracker idle;
 };
 
 LADSPA_Handle
@@ -21,6 +33,9 @@ instantiate(const LADSPA_Descriptor *d, unsigned long fs)
 {
 	auto p = new filter;
 	p->fs = fs;
+	p->idle.init(d);
+	p->bq.set_kernel(biquad_kernel_from_env());
+	p->bq.set_precision(biquad_precision_from_env());
 	return p;
 }
 
@@ -29,15 +44,17 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 {
 	filter *p = reinterpret_cast<filter *>(h);
 
+	if (p->idle.connect(port, d))
+		return;
 	switch (port) {
 	case 0:
-		p->f0 = *d;
+		p->f0.connect(d);
 		return;
 	case 1:
-		p->gain = *d;
+		p->gain.connect(d);
 		return;
 	case 2:
-		p->Q = *d;
+		p->Q.connect(d);
 		return;
 	}
 	port -= control;
@@ -46,23 +63,163 @@ connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
 	p->io[port / 2][port % 2] = d;
 }
 
+/*
+ * key - cache key for the current ramp values
+ */
+coefficient_key
+key(const filter *p)
+{
+	return {
+		.type = coefficient_key::filter::peaking,
+		.f0 = std::exp(p->log_f0.value()),
+		.gain = p->gain_db.value(),
+		.Q = p->bandwidth.value(),
+		.fs = p->fs,
+	};
+}
+
+/*
+ * compute - compute coefficients for the current ramp values
+ */
+void
+compute(const filter *p, std::array<biquad_coefficients, 1> &c,
+	biquad_design d)
+{
+	c[0].peaking_eq(std::exp(p->log_f0.value()), p->gain_db.value(),
+		     p->bandwidth.value(), p->fs, d);
+}
+
+/*
+ * design - select coefficients for the current ramp values
+ *
+ * Settled designs are shared with other instances if they have already been
+ * cached by activate(). Designs at 0dB pass the input through unchanged and
+ * stop being run once the response to earlier settings has died away.
+ */
+void
+design(filter *p, biquad_design d = biquad_design::exact)
+{
+	if (d != biquad_design::exact ||
+	    !(p->coeffs = coefficient_cache<1>::find(key(p)))) {
+		compute(p, p->bqc, d);
+		p->coeffs = &p->bqc;
+	}
+	p->passthrough = (*p->coeffs)[0].passthrough();
+}
+
+/*
+ * ramping - check if any parameter is moving towards a new value
+ */
+bool
+ramping(const filter *p)
+{
+	return !p->log_f0.settled() || !p->gain_db.settled() ||
+	       !p->bandwidth.settled();
+}
+
+/*
+ * update - retarget parameter ramps if any control has changed
+ */
+void
+update(filter *p)
+{
+	auto changed = p->f0.update();
+	changed |= p->gain.update();
+	changed |= p->Q.update();
+	if (!changed)
+		return;
+
+	/* frequency ramps in octaves rather than hertz */
+	const size_t len = p->fs * ramp_time;
+	p->log_f0.set(std::log(std::max<double>(p->f0, 1)), len);
+	p->gain_db.set(p->gain, len);
+	p->bandwidth.set(p->Q, len);
+
+	/* ramping parameters are designed block by block in run() */
+	if (!ramping(p))
+		design(p);
+}
+
 void
 activate(LADSPA_Handle h)
 {
 	filter *p = reinterpret_cast<filter *>(h);
-	p->bqc.peaking_eq(p->f0, p->gain, p->Q, p->fs);
+	update(p);
+	p->idle.reset();
+	p->log_f0.finish();
+	p->gain_db.finish();
+	p->bandwidth.finish();
+	p->coeffs = coefficient_cache<1>::insert(key(p), [p](auto &c) {
+		compute(p, c, biquad_design::exact);
+	});
+	if (!p->coeffs)
+		design(p);
+	p->passthrough = (*p->coeffs)[0].passthrough();
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
+
+	std::array<const LADSPA_Data *, channels> in;
+	std::array<LADSPA_Data *, channels> out;
+	auto n = connected_channels(p->io, in, out);
+
+	/* store silence while silence goes in and the filter has decayed */
+	const auto idle = p->idle.quiet(data(in), n, samples) &&
+			  !ramping(p) && p->bq.quiet(1, silence);
+	if (p->idle.set(idle, samples)) {
+		store_silence(data(in), data(out), n, samples, store);
+		return;
+	}
+
+	for (unsigned long i = 0, len; i < samples; i += len) {
+		len = samples - i;
+		if (ramping(p)) {
+			len = std::min<unsigned long>(len, ramp_block);
+			p->log_f0.advance(len);
+			p->gain_db.advance(len);
+			p->bandwidth.advance(len);
+			/* approximate while moving, exact once settled */
+			design(p, ramping(p) ? biquad_design::fast
+					     : biquad_design::exact);
+		}
+		if (p->passthrough && p->bq.transparent(0, 0, n)) {
+			p->bq.skip(data(in), n, len);
+			for (size_t c = 0; c < n; ++c)
+				store.block(out[c], in[c], len);
+		} else
+			p->bq.run(*p->coeffs, 1, data(in), data(out), n, len,
+				  store);
+		advance_channels(in, out, n, len);
+	}
 }
 
 void
 run(LADSPA_Handle h, unsigned long samples)
 {
 	filter *p = reinterpret_cast<filter *>(h);
-	for (auto i = 0; i < channels; ++i) {
-		/* stop on first unconnected port */
-		if (!p->io[i][0] || !p->io[i][1])
-			return;
-		p->bq[i].run(p->bqc, p->io[i][0], p->io[i][1], samples);
-	}
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
 }
 
 void
@@ -158,8 +315,8 @@ struct init {
 			.connect_port = connect_port,
 			.activate = activate,
 			.run = run,
-			.run_adding = nullptr,
-			.set_run_adding_gain = nullptr,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
 			.deactivate = nullptr,
 			.cleanup = cleanup,
 		};
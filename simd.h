@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+ * Compile the SIMD kernels for both the baseline instruction set and AVX2 and
+ * pick the best one at load time.
+ */
+#if defined(__x86_64__)
+#define simd_clones __attribute__((target_clones("avx2", "default")))
+#else
+#define simd_clones
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+/*
+ * Time taken to ramp to a new control value and the number of samples
+ * between coefficient updates while ramping.
+ */
+constexpr auto ramp_time = 0.02;	/* in seconds */
+constexpr auto ramp_block = 32;		/* in samples */
+
+/*
+ * ramp - linear ramp towards a target value
+ *
+ * Used to smooth control changes. Once the target has been reached the ramp
+ * is settled and callers should fall back to their fixed parameter paths.
+ */
+class ramp {
+public:
+	/*
+	 * set - ramp to 'target' over 'samples' samples
+	 *
+	 * The first target set jumps straight to the value.
+	 */
+	void set(double target, size_t samples)
+	{
+		if (!valid_ || !samples)
+			return jump(target);
+		if (target == target_)
+			return;
+		target_ = target;
+		remaining_ = samples;
+		step_ = (target_ - value_) / samples;
+	}
+
+	/*
+	 * jump - jump straight to 'value'
+	 */
+	void jump(double value)
+	{
+		valid_ = true;
+		value_ = target_ = value;
+		remaining_ = 0;
+	}
+
+	/*
+	 * finish - jump to the target value
+	 */
+	void finish()
+	{
+		value_ = target_;
+		remaining_ = 0;
+	}
+
+	/*
+	 * advance - advance the ramp by 'samples' samples
+	 */
+	void advance(size_t samples)
+	{
+		if (samples >= remaining_)
+			return finish();
+		value_ += step_ * samples;
+		remaining_ -= samples;
+	}
+
+	bool settled() const
+	{
+		return !remaining_;
+	}
+
+	double value() const
+	{
+		return value_;
+	}
+
+	double target() const
+	{
+		return target_;
+	}
+
+	/* per sample increment while ramping */
+	double step() const
+	{
+		return step_;
+	}
+
+	/* samples until the target is reached */
+	size_t remaining() const
+	{
+		return remaining_;
+	}
+
+private:
+	double value_ = 0, target_ = 0, step_ = 0;
+	size_t remaining_ = 0;
+	bool valid_ = false;
+};
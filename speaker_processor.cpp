@@ -0,0 +1,707 @@
+#include "biquad.h"
+#include "control.h"
+#include "delay_line.h"
+#include "denormal.h"
+#include "descriptor.h"
+#include "eq_band.h"
+#include "idle.h"
+#include "ladspa_ids.h"
+#include "smooth.h"
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto channels = 8;
+constexpr auto bands = 8;
+constexpr auto max_delay_ms = 5000;
+
+/* highpass, eq, gain, polarity & delay controls of each channel */
+constexpr auto control = 2 + bands * eq_band::controls + 3;
+
+/* samples processed through the chain at a time */
+constexpr auto block = 256;
+
+/*
+ * channel - processing chain for one output
+ *
+ * The chain is highpass -> parametric eq -> gain -> polarity -> delay with
+ * settings for every channel. It is compiled into as few stages as possible:
+ * the highpass and the eq bands which change the signal are packed into one
+ * cascade, gain and polarity become a single signed gain which is skipped at
+ * unity, and the delay is skipped when it is zero. As every stage is linear
+ * the delay is run first so that the gain can be applied as the result is
+ * stored to the output.
+ */
+struct channel {
+	control_port hpf_f0, hpf_order;
+	std::array<eq_band, bands> eq;
+	control_port gain_db, polarity, delay_ms;
+	LADSPA_Data *in = nullptr, *out = nullptr;
+
+	/* filter stage */
+	ramp log_hpf_f0;
+	unsigned order = 0;
+	size_t hpf_sections = 0;
+	size_t sections = 0;
+	bool draining = false;
+	std::array<biquad_coefficients, 16> bqc;
+
+	/* gain & polarity stage, as a signed magnitude */
+	ramp gain;
+
+	/* delay stage */
+	unsigned long wanted_delay = 0;	/* in samples, as set by the control */
+	unsigned long delay = 0;	/* in samples */
+	unsigned long old_delay = 0;	/* in samples, while fading */
+	ramp fade;			/* from old_delay to delay */
+};
+
+/*
+ * filter - speaker processor
+ *
+ * The filter stages of all channels run through one cascade with separate
+ * coefficients for each channel so that channels are still processed in
+ * parallel. Channels with fewer sections than others are padded with
+ * identity sections.
+ */
+struct filter {
+	std::array<channel, channels> ch;
+	biquad_cascade<16> bq;
+	std::vector<delay_line> lines;
+	unsigned long max_delay = 1;	/* in samples */
+	control_warning order_high, delay_high, uncommitted;
+	LADSPA_Data adding_gain = 1;
+	unsigned long fs = 0;
+	idle_tracker idle;
+
+	/* output of the delay stage and the filter stage */
+	alignas(32) std::array<std::array<float, block>, channels> x, y;
+};
+
+LADSPA_Handle
+instantiate(const LADSPA_Descriptor *d, unsigned long fs)
+{
+	auto p = new filter;
+	p->fs = fs;
+	p->idle.init(d);
+	p->max_delay = std::max<unsigned long>(1, max_delay_ms / 1000.0 * fs);
+	p->bq.set_kernel(biquad_kernel_from_env());
+	p->bq.set_precision(biquad_precision_from_env());
+	for (auto &c : p->ch)
+		for (auto &b : c.bqc)
+			b.identity();
+	const auto n = idle_port(d) / (control + 2);
+	p->lines.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+		p->lines.emplace_back(p->max_delay);
+	return p;
+}
+
+void
+connect_port(LADSPA_Handle h, unsigned long port, LADSPA_Data *d)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+
+	if (p->idle.connect(port, d))
+		return;
+	if (port >= (control + 2) * channels)
+		return;
+	auto &c = p->ch[port / (control + 2)];
+	port %= control + 2;
+	switch (port) {
+	case 0:
+		return c.hpf_f0.connect(d);
+	case 1:
+		return c.hpf_order.connect(d);
+	case control - 3:
+		return c.gain_db.connect(d);
+	case control - 2:
+		return c.polarity.connect(d);
+	case control - 1:
+		return c.delay_ms.connect(d);
+	case control:
+		c.in = d;
+		return;
+	case control + 1:
+		c.out = d;
+		return;
+	}
+	port -= 2;
+	c.eq[port / eq_band::controls].connect(port % eq_band::controls, d);
+}
+
+/*
+ * design_hpf - compute highpass coefficients for the current ramp value
+ */
+void
+design_hpf(const filter *p, channel &c,
+	   biquad_design d = biquad_design::exact)
+{
+	butterworth_highpass(data(c.bqc), c.order, std::exp(c.log_hpf_f0.value()),
+			     p->fs, d);
+}
+
+/*
+ * pack - pack and design the eq bands of channel i which change the signal
+ */
+void
+pack(filter *p, size_t i)
+{
+	auto &c = p->ch[i];
+	c.sections = pack_bands(c.eq, c.bqc, p->bq, c.hpf_sections, c.sections,
+				i, i + 1, p->fs, c.draining);
+}
+
+/*
+ * drain - remove the eq bands of channel i which have left the cascade once
+ * drained
+ */
+void
+drain(filter *p, size_t i)
+{
+	auto &c = p->ch[i];
+	c.sections = drain_bands(c.eq, c.bqc, p->bq, c.sections, i, i + 1,
+				 c.draining);
+}
+
+/*
+ * resize_hpf - change the number of highpass sections of channel i
+ *
+ * Sections are inserted or erased at the front of the cascade so that the
+ * eq bands after them keep their state.
+ */
+void
+resize_hpf(filter *p, size_t i, size_t hpf_sections)
+{
+	auto &c = p->ch[i];
+	auto first = std::begin(c.bqc), last = first + c.sections;
+	if (hpf_sections > c.hpf_sections) {
+		const auto n = hpf_sections - c.hpf_sections;
+		for (size_t k = 0; k < n; ++k)
+			p->bq.insert(0, i);
+		std::copy_backward(first, last, last + n);
+		c.sections += n;
+		for (auto &b : c.eq)
+			if (b.packed)
+				b.section += n;
+	} else {
+		const auto n = c.hpf_sections - hpf_sections;
+		for (size_t k = 0; k < n; ++k)
+			p->bq.erase(0, i);
+		std::copy(first + n, last, first);
+		c.sections -= n;
+		for (auto &b : c.eq)
+			if (b.packed)
+				b.section -= n;
+		for (auto k = c.sections; k < c.sections + n; ++k)
+			c.bqc[k].identity();
+	}
+	c.hpf_sections = hpf_sections;
+}
+
+/*
+ * update_filters - retarget filter ramps or resize the cascade of channel i
+ */
+void
+update_filters(filter *p, size_t i)
+{
+	auto &c = p->ch[i];
+	auto resize = false;
+	auto hpf_changed = false;
+	if (c.hpf_f0.update()) {
+		/* frequency ramps in octaves rather than hertz */
+		c.log_hpf_f0.set(std::log(std::max<double>(c.hpf_f0, 1)),
+				 p->fs * ramp_time);
+		hpf_changed = true;
+	}
+	if (c.hpf_order.update()) {
+		/* clamp before converting, negative values and NaN turn the
+		 * highpass off */
+		LADSPA_Data order = c.hpf_order;
+		if (order > 16) {
+			p->order_high.raise();
+			order = 16;
+		}
+		if (std::isnan(order) || order < 0)
+			order = 0;
+		resize |= static_cast<unsigned>(order) != c.order;
+		c.order = order;
+	}
+	/* a highpass which is off doesn't need to ramp */
+	if (!c.order)
+		c.log_hpf_f0.finish();
+	auto eq_changed = false;
+	for (auto &b : c.eq) {
+		bool changed;
+		b.update(p->fs, changed);
+		eq_changed |= changed;
+	}
+
+	if (resize) {
+		/* a section per pole pair plus one for a real pole */
+		resize_hpf(p, i, (c.order + 1) / 2);
+		design_hpf(p, c, c.log_hpf_f0.settled() ? biquad_design::exact
+							: biquad_design::fast);
+	}
+
+	/* ramping filters are designed block by block in run() */
+	if (hpf_changed && c.log_hpf_f0.settled())
+		design_hpf(p, c);
+	if (eq_changed)
+		pack(p, i);
+}
+
+/*
+ * update_gain - retarget the gain ramp if gain or polarity changed
+ */
+void
+update_gain(filter *p, channel &c)
+{
+	auto changed = c.gain_db.update();
+	changed |= c.polarity.update();
+	if (!changed)
+		return;
+
+	/* db->magnitude */
+	auto g = std::pow(10.0, c.gain_db / 20.0);
+	c.gain.set(c.polarity > 0 ? -g : g, p->fs * ramp_time);
+}
+
+/*
+ * latch_delay - recompute the wanted delay, returns true if it changed
+ */
+bool
+latch_delay(filter *p, channel &c)
+{
+	if (!c.delay_ms.update())
+		return false;
+
+	/* clamp before converting, negative values and NaN are no delay */
+	double samples = std::round(c.delay_ms / 1000.0 * p->fs);
+	if (samples > p->max_delay) {
+		p->delay_high.raise();
+		samples = p->max_delay;
+	}
+	if (std::isnan(samples) || samples < 0)
+		samples = 0;
+	c.wanted_delay = samples;
+	return true;
+}
+
+/*
+ * retarget_delay - move to the wanted delay as far as the line can hold it
+ *
+ * Changes between two delays are crossfaded as in the delay plugin. Changes
+ * to or from zero switch the delay stage on or off immediately.
+ */
+void
+retarget_delay(filter *p, channel &c, delay_line &line)
+{
+	const auto delay = std::min<unsigned long>(c.wanted_delay,
+						   line.capacity());
+	if (delay == c.delay)
+		return;
+
+	/* the history is stale after running without the delay stage */
+	if (!c.delay || !delay) {
+		if (!c.delay)
+			line.clear();
+		c.delay = delay;
+		c.fade.jump(1);
+		return;
+	}
+
+	/* crossfade to the new read position from whichever one dominates
+	 * the output right now */
+	if (c.fade.value() >= 0.5)
+		c.old_delay = c.delay;
+	c.delay = delay;
+	c.fade.jump(0);
+	c.fade.set(1, p->fs * ramp_time);
+}
+
+/*
+ * update_delay - retarget the delay if the control has changed
+ *
+ * Committing memory may block, so only activate() grows the lines. Longer
+ * delays set while running are limited to what the line can hold until the
+ * plugin is activated again.
+ */
+void
+update_delay(filter *p, channel &c, delay_line &line)
+{
+	if (!latch_delay(p, c))
+		return;
+	retarget_delay(p, c, line);
+	if (c.delay < c.wanted_delay)
+		p->uncommitted.raise();
+}
+
+void
+update(filter *p)
+{
+	for (size_t i = 0; i < size(p->lines); ++i) {
+		auto &c = p->ch[i];
+		update_filters(p, i);
+		update_gain(p, c);
+		update_delay(p, c, p->lines[i]);
+	}
+}
+
+/*
+ * report - print warnings about controls corrected since the last report
+ */
+void
+report(filter *p)
+{
+	p->order_high.report("WARNING: Maximum supported highpass order is 16. Clamping.\n");
+	p->delay_high.report("WARNING: Maximum delay is %.2fms at %luHz. Clamping.\n",
+			     p->max_delay * 1000.0 / p->fs, p->fs);
+	p->uncommitted.report("WARNING: Delay increased while running. Limiting it until the plugin is activated again.\n");
+	for (auto &c : p->ch)
+		for (auto &b : c.eq)
+			b.report();
+}
+
+void
+activate(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	for (size_t i = 0; i < size(p->lines); ++i) {
+		auto &c = p->ch[i];
+		auto &line = p->lines[i];
+		latch_delay(p, c);
+		if (!line.resize(c.wanted_delay))
+			fprintf(stderr, "WARNING: Out of memory for %.2fms delay. Clamping.\n",
+				c.wanted_delay * 1000.0 / p->fs);
+		retarget_delay(p, c, line);
+	}
+	update(p);
+	report(p);
+	p->idle.reset();
+	for (size_t i = 0; i < size(p->lines); ++i) {
+		auto &c = p->ch[i];
+		c.log_hpf_f0.finish();
+		design_hpf(p, c);
+		for (auto &b : c.eq)
+			b.finish();
+		pack(p, i);
+		c.gain.finish();
+		c.fade.jump(1);
+	}
+}
+
+void
+deactivate(LADSPA_Handle h)
+{
+	report(reinterpret_cast<filter *>(h));
+}
+
+/*
+ * ramping - check if any filter of a channel is moving to new settings
+ */
+bool
+ramping(const channel &c)
+{
+	if (!c.log_hpf_f0.settled())
+		return true;
+	for (auto &b : c.eq)
+		if (b.ramping())
+			return true;
+	return false;
+}
+
+/*
+ * advance_filters - advance filter ramps of channel i & redesign the filters
+ * which moved
+ */
+void
+advance_filters(filter *p, size_t i, size_t samples)
+{
+	auto &c = p->ch[i];
+	/* approximate while moving, exact once settled */
+	auto design = [](const ramp &r) {
+		return r.settled() ? biquad_design::exact : biquad_design::fast;
+	};
+	if (!c.log_hpf_f0.settled()) {
+		c.log_hpf_f0.advance(samples);
+		design_hpf(p, c, design(c.log_hpf_f0));
+	}
+	auto settled = false;
+	for (auto &b : c.eq) {
+		if (!b.ramping())
+			continue;
+		b.advance(samples);
+		settled |= !b.ramping();
+		b.design(c.bqc[b.section], p->fs,
+			 b.ramping() ? biquad_design::fast
+				     : biquad_design::exact);
+	}
+	if (settled)
+		pack(p, i);
+}
+
+/*
+ * apply_gain - scale samples by the gain of a channel and store them
+ */
+template<typename S>
+void
+apply_gain(channel &c, const float *in, float *out, size_t samples, S store)
+{
+	/* ramp sample by sample until the gain settles */
+	const auto len = std::min<size_t>(samples, c.gain.remaining());
+	const LADSPA_Data g0 = c.gain.value();
+	const LADSPA_Data step = c.gain.step();
+	const LADSPA_Data g = c.gain.target();
+	for (size_t j = 0; j < len; ++j)
+		store(out[j], in[j] * (g0 + step * (j + 1)));
+	/* unity gain is a copy, or nothing at all in place */
+	if (g == 1)
+		store.block(out + len, in + len, samples - len);
+	else {
+		for (size_t j = len; j < samples; ++j)
+			store(out[j], in[j] * g);
+	}
+	c.gain.advance(samples);
+}
+
+/*
+ * process - run the plugin, storing output with policy S
+ */
+template<typename S>
+void
+process(filter *p, unsigned long samples, S store)
+{
+	denormals_off guard;
+	update(p);
+
+	/* stop on first unconnected port */
+	size_t n = 0;
+	for (; n < channels; ++n)
+		if (!p->ch[n].in || !p->ch[n].out)
+			break;
+
+	std::array<const std::array<biquad_coefficients, 16> *, channels> coeffs;
+	auto sections = [&] {
+		size_t s = 0;
+		for (size_t i = 0; i < n; ++i)
+			s = std::max(s, p->ch[i].sections);
+		return s;
+	};
+	for (size_t i = 0; i < n; ++i)
+		coeffs[i] = &p->ch[i].bqc;
+
+	/* store silence once silence comes out of the delay stage and the
+	 * filters have decayed, and catch the delay lines up with the silence
+	 * skipped when the input returns */
+	std::array<const float *, channels> src;
+	unsigned long tail = 0;
+	auto settled = true;
+	for (size_t i = 0; i < n; ++i) {
+		auto &c = p->ch[i];
+		src[i] = c.in;
+		tail = std::max(tail, c.delay);
+		settled &= !ramping(c) && c.gain.settled() && c.fade.settled();
+	}
+	const auto idle = p->idle.quiet(data(src), n, samples, tail) &&
+			  settled &&
+			  (!sections() || p->bq.quiet(sections(), silence));
+	if (p->idle.set(idle, samples)) {
+		for (size_t i = 0; i < n; ++i)
+			store_silence(p->ch[i].in, p->ch[i].out, samples,
+				      store);
+		return;
+	}
+	if (auto skipped = p->idle.resume())
+		for (size_t i = 0; i < n; ++i)
+			if (p->ch[i].delay)
+				p->lines[i].skip(skipped);
+
+	std::array<float *, channels> y;
+	for (unsigned long j = 0, len; j < samples; j += len) {
+		len = std::min<unsigned long>(samples - j, block);
+		for (size_t i = 0; i < n; ++i) {
+			if (ramping(p->ch[i]))
+				len = std::min<unsigned long>(len, ramp_block);
+		}
+
+		/* delay stage, crossfading until the fade settles */
+		for (size_t i = 0; i < n; ++i) {
+			auto &c = p->ch[i];
+			if (ramping(c))
+				advance_filters(p, i, len);
+			/* bands which settled at 0dB or were switched off
+			 * leave the cascade once drained */
+			if (c.draining)
+				drain(p, i);
+			src[i] = c.in + j;
+			y[i] = data(p->y[i]);
+			if (!c.delay)
+				continue;
+			auto &line = p->lines[i];
+			auto x = data(p->x[i]);
+			auto fl = std::min<unsigned long>(len, c.fade.remaining());
+			line.crossfade(src[i], x, c.old_delay, c.delay,
+				       c.fade.value(), c.fade.step(), fl);
+			line.run(src[i] + fl, x + fl, c.delay, len - fl);
+			c.fade.advance(len);
+			src[i] = x;
+		}
+
+		/* filter stage, bands may have left it as they settled */
+		if (auto s = sections()) {
+			p->bq.run(data(coeffs), s, data(src), data(y), n, len);
+			std::copy(begin(y), end(y), begin(src));
+		} else
+			p->bq.skip(data(src), n, len);
+
+		/* gain & polarity stage */
+		for (size_t i = 0; i < n; ++i)
+			apply_gain(p->ch[i], src[i], p->ch[i].out + j, len,
+				   store);
+	}
+}
+
+void
+run(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, replace{});
+}
+
+void
+run_adding(LADSPA_Handle h, unsigned long samples)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	process(p, samples, accumulate{p->adding_gain});
+}
+
+void
+set_run_adding_gain(LADSPA_Handle h, LADSPA_Data gain)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	p->adding_gain = gain;
+}
+
+void
+cleanup(LADSPA_Handle h)
+{
+	filter *p = reinterpret_cast<filter *>(h);
+	delete p;
+}
+
+/*
+ * register plugin instances
+ *
+ * Port layout is the controls, input & output of each channel in turn so
+ * that every channel has its own settings.
+ */
+struct init {
+	static constexpr auto count = (control + 2) * channels;
+
+	/* descriptors keep pointers to these */
+	std::array<LADSPA_PortDescriptor, count> ports;
+	std::array<std::string, count> names;
+	std::array<const char *, count> port_names;
+	std::array<LADSPA_PortRangeHint, count> port_hints;
+
+	init()
+	{
+		for (size_t i = 0; i < channels; ++i) {
+			auto ch = "Channel " + std::to_string(i + 1);
+			auto p = i * (control + 2);
+			for (size_t k = 0; k < control; ++k)
+				ports[p + k] = LADSPA_PORT_CONTROL |
+					       LADSPA_PORT_INPUT;
+			names[p] = ch + " Highpass Frequency (Hz)";
+			port_hints[p] = {
+				.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+						  LADSPA_HINT_BOUNDED_ABOVE |
+						  LADSPA_HINT_SAMPLE_RATE |
+						  LADSPA_HINT_LOGARITHMIC |
+						  LADSPA_HINT_DEFAULT_LOW,
+				.LowerBound = 0.0005,
+				.UpperBound = 0.45,
+			};
+			names[p + 1] = ch + " Highpass Order (0 to 16)";
+			port_hints[p + 1] = {
+				.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+						  LADSPA_HINT_BOUNDED_ABOVE |
+						  LADSPA_HINT_INTEGER |
+						  LADSPA_HINT_DEFAULT_0,
+				.LowerBound = 0,
+				.UpperBound = 16,
+			};
+			for (size_t k = 0; k < bands; ++k) {
+				auto b = p + 2 + k * eq_band::controls;
+				eq_band::describe(ch + " Band " +
+						  std::to_string(k + 1),
+						  &ports[b], &names[b],
+						  &port_hints[b]);
+			}
+			p += control - 3;
+			names[p] = ch + " Gain (dB)";
+			port_hints[p] = {
+				.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+						  LADSPA_HINT_BOUNDED_ABOVE |
+						  LADSPA_HINT_DEFAULT_0,
+				.LowerBound = -100,
+				.UpperBound = 100,
+			};
+			names[p + 1] = ch + " Invert Polarity";
+			port_hints[p + 1] = {
+				.HintDescriptor = LADSPA_HINT_TOGGLED |
+						  LADSPA_HINT_DEFAULT_0,
+			};
+			names[p + 2] = ch + " Delay (ms)";
+			port_hints[p + 2] = {
+				.HintDescriptor = LADSPA_HINT_BOUNDED_BELOW |
+						  LADSPA_HINT_BOUNDED_ABOVE |
+						  LADSPA_HINT_DEFAULT_0,
+				.LowerBound = 0,
+				.UpperBound = max_delay_ms,
+			};
+			ports[p + 3] = LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT;
+			names[p + 3] = ch + " Input";
+			ports[p + 4] = LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT;
+			names[p + 4] = ch + " Output";
+		}
+		for (size_t i = 0; i < count; ++i)
+			port_names[i] = names[i].c_str();
+
+		LADSPA_Descriptor d = {
+			.UniqueID = 0,
+			.Label = nullptr,
+			.Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+			.Name = nullptr,
+			.Maker = "Patrick Oppenlander <patrick.oppenlander@gmail.com>",
+			.Copyright = "Patrick Oppenlander, 2021",
+			.PortCount = 0,
+			.PortDescriptors = data(ports),
+			.PortNames = data(port_names),
+			.PortRangeHints = data(port_hints),
+			.ImplementationData = nullptr,
+			.instantiate = instantiate,
+			.connect_port = connect_port,
+			.activate = activate,
+			.run = run,
+			.run_adding = run_adding,
+			.set_run_adding_gain = set_run_adding_gain,
+			.deactivate = deactivate,
+			.cleanup = cleanup,
+		};
+
+		for (int i = 0; i < channels; ++i) {
+			d.UniqueID = ladspa_ids::speaker_processor + i;
+			d.PortCount = (control + 2) * (i + 1);
+			register_plugin({d,
+			    "speaker_processor_" + std::to_string(i + 1) + "ch",
+			    "Speaker Processor (" + std::to_string(i + 1) + " Channel)"});
+		}
+	}
+} init;
+
+} /* namespace */
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+/*
+ * replace, accumulate - how kernels store their results
+ *
+ * Kernels are templated on one of these so that run() and run_adding() share
+ * a single implementation. replace overwrites the output, accumulate adds the
+ * result scaled by the run_adding gain to it. T may be a scalar or a vector.
+ * silence() stores silence, which leaves an accumulated output as it is.
+ */
+struct replace {
+	template<typename T>
+	void operator()(T &out, T y) const
+	{
+		out = y;
+	}
+
+	void block(float *out, const float *in, size_t samples) const
+	{
+		/* nothing to do when the host processes in place */
+		if (out != in)
+			memcpy(out, in, samples * sizeof(float));
+	}
+
+	void silence(float *out, size_t samples) const
+	{
+		memset(out, 0, samples * sizeof(float));
+	}
+};
+
+struct accumulate {
+	float gain;
+
+	template<typename T>
+	void operator()(T &out, T y) const
+	{
+		out += gain * y;
+	}
+
+	void block(float *out, const float *in, size_t samples) const
+	{
+		for (size_t i = 0; i < samples; ++i)
+			out[i] += gain * in[i];
+	}
+
+	void silence(float *, size_t) const
+	{ }
+};